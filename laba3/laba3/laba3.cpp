@@ -1,6 +1,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <atomic>
 
 class Book {
 private:
@@ -72,7 +73,7 @@ private:
     std::string name;
     int readerId;
     std::vector<Book*> borrowedBooks;
-    static int readerCount; //     
+    static std::atomic<int> readerCount; //     
 
 public:
     Reader(std::string n, int id) : name(n), readerId(id) {
@@ -106,7 +107,7 @@ public:
     }
 };
 
-int Reader::readerCount = 0; //   
+std::atomic<int> Reader::readerCount(0); //   
 
 int main() {
     Book book1("1984", "George Orwell", "123456789");
@@ -1,12 +1,35 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <memory>
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include <limits>
 #include <algorithm>
-#include <unordered_set>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <mutex>
+#include <map>
+#include <cmath>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -23,8 +46,8 @@ public:
 
     virtual ~LibraryItem() = default;
 
-    virtual void display() const {
-        cout << "Title: " << title << ", Author: " << author << ", ID: " << id;
+    virtual void display(ostream& out) const {
+        out << "Title: " << title << ", Author: " << author << ", ID: " << id;
     }
 
     virtual string toFileString() const {
@@ -45,21 +68,31 @@ public:
     string getId() const {
         return id;
     }
+
+    const string& getTitle() const {
+        return title;
+    }
+
+    const string& getAuthor() const {
+        return author;
+    }
 };
 
 // Книга
 class Book : public LibraryItem {
     string ISBN;
     bool isBorrowed;
+    bool isReserved = false;  // відкладена для читача з черги; у файл не пишеться
 
 public:
     Book(const string& t = "", const string& a = "", const string& i = "", 
          const string& isbn = "", bool borrowed = false)
         : LibraryItem(t, a, i), ISBN(isbn), isBorrowed(borrowed) {}
 
-    void display() const override {
-        LibraryItem::display();
-        cout << ", ISBN: " << ISBN << ", Status: " << (isBorrowed ? "Borrowed" : "Available") << endl;
+    void display(ostream& out) const override {
+        LibraryItem::display(out);
+        out << ", ISBN: " << ISBN << ", Status: "
+            << (isBorrowed ? "Borrowed" : isReserved ? "Reserved" : "Available") << endl;
     }
 
     string toFileString() const override {
@@ -87,6 +120,27 @@ public:
         if (isBorrowed) throw runtime_error("Book already borrowed!");
         isBorrowed = true;
     }
+
+    void giveBack() {
+        if (!isBorrowed) throw runtime_error("Book is not borrowed!");
+        isBorrowed = false;
+    }
+
+    bool getBorrowedStatus() const {
+        return isBorrowed;
+    }
+
+    void setBorrowedStatus(bool borrowed) {
+        isBorrowed = borrowed;
+    }
+
+    void setReserved(bool reserved) {
+        isReserved = reserved;
+    }
+
+    const string& getISBN() const {
+        return ISBN;
+    }
 };
 
 // Журнал
@@ -97,9 +151,13 @@ public:
     Magazine(const string& t = "", const string& a = "", const string& i = "", int issue = 0)
         : LibraryItem(t, a, i), issueNumber(issue) {}
 
-    void display() const override {
-        LibraryItem::display();
-        cout << ", Issue: " << issueNumber << endl;
+    void display(ostream& out) const override {
+        LibraryItem::display(out);
+        out << ", Issue: " << issueNumber << endl;
+    }
+
+    int getIssue() const {
+        return issueNumber;
     }
 
     string toFileString() const override {
@@ -118,10 +176,16 @@ public:
 // Користувач
 class User {
     string name;
+    uint64_t readerId;
     vector<shared_ptr<LibraryItem>> borrowedItems;
 
 public:
-    User(const string& n = "") : name(n) {}
+    User(const string& n = "", uint64_t id = 0) : name(n), readerId(id) {}
+
+    // Відновлення позики з реєстру без повторного позичання
+    void restoreItem(shared_ptr<LibraryItem> item) {
+        borrowedItems.push_back(item);
+    }
 
     void borrowItem(shared_ptr<LibraryItem> item) {
         // Спроба позичити, якщо це книга
@@ -129,17 +193,46 @@ public:
             book->borrow();
         }
         borrowedItems.push_back(item);
-        cout << "Item borrowed successfully!\n";
     }
 
-    void displayBorrowed() const {
+    shared_ptr<LibraryItem> returnItem(size_t index) {
+        if (index >= borrowedItems.size()) throw out_of_range("Invalid borrowed item number");
+        shared_ptr<LibraryItem> item = borrowedItems[index];
+        if (auto book = dynamic_pointer_cast<Book>(item)) {
+            book->giveBack();
+        }
+        borrowedItems.erase(borrowedItems.begin() + index);
+        return item;
+    }
+
+    const string& getName() const {
+        return name;
+    }
+
+    uint64_t getReaderId() const {
+        return readerId;
+    }
+
+    size_t borrowedCount() const {
+        return borrowedItems.size();
+    }
+
+    bool hasBorrowed(const string& itemId) const {
+        for (const auto& item : borrowedItems) {
+            if (item->getId() == itemId) return true;
+        }
+        return false;
+    }
+
+    void displayBorrowed(ostream& out) const {
         if (borrowedItems.empty()) {
-            cout << "No items borrowed.\n";
+            out << "No items borrowed.\n";
             return;
         }
-        cout << "\nBorrowed items by " << name << ":\n";
-        for (const auto& item : borrowedItems) {
-            item->display();
+        out << "\nBorrowed items by " << name << ":\n";
+        for (size_t i = 0; i < borrowedItems.size(); ++i) {
+            out << i + 1 << ". ";
+            borrowedItems[i]->display(out);
         }
     }
 
@@ -151,258 +244,2882 @@ public:
     }
 };
 
-// Робота з файлами
-class FileManager {
-    const string itemsFile = "library_items.dat";
-    const string usersFile = "users_history.dat";
+// Блоковий фільтр Блума для ID (один блок = одна кеш-лінія в 64 байти)
+class IdFilter {
+    static const size_t wordsPerBlock = 8;
+    static const size_t bitsPerItem = 10;
+    static const int hashCount = 7;
+    static const uint32_t fileMagic = 0x3346424C; // "LBF3"
+    static const uint64_t maxCapacity = 1ULL << 32;
 
-public:
-    void saveItems(const vector<shared_ptr<LibraryItem>>& items) {
-        ofstream file(itemsFile);
-        if (!file.is_open()) throw runtime_error("Cannot open file: " + itemsFile);
+    vector<uint64_t> words;
+    uint64_t blockCount = 0;
+    uint64_t itemCount = 0;
+    uint64_t capacity = 0;
+    uint64_t catalogSize = 0;      // відбиток library_items.dat, для якого побудовано фільтр
+    int64_t catalogModified = 0;
 
-        for (const auto& item : items) {
-            string type;
-            if (dynamic_cast<Book*>(item.get())) type = "BOOK|";
-            else if (dynamic_cast<Magazine*>(item.get())) type = "MAGAZINE|";
-            file << type << item->toFileString() << "\n";
+    // FNV-1a: стабільний між запусками, тому фільтр можна зберігати у файл
+    static uint64_t hashId(const string& id) {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : id) {
+            h ^= c;
+            h *= 1099511628211ULL;
         }
+        return h;
     }
 
-    vector<shared_ptr<LibraryItem>> loadItems() {
-        vector<shared_ptr<LibraryItem>> items;
-        ifstream file(itemsFile);
-        if (!file.is_open()) return items;
+    static uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
 
-        string line;
-        while (getline(file, line)) {
-            size_t pos = line.find('|');
-            if (pos == string::npos) continue;
+    static uint64_t blocksFor(uint64_t capacity) {
+        return (capacity * bitsPerItem + wordsPerBlock * 64 - 1) / (wordsPerBlock * 64);
+    }
 
-            string type = line.substr(0, pos);
-            string data = line.substr(pos + 1);
+public:
+    IdFilter() {
+        reset(0);
+    }
 
-            shared_ptr<LibraryItem> item;
-            if (type == "BOOK") item = make_shared<Book>();
-            else if (type == "MAGAZINE") item = make_shared<Magazine>();
-            else continue;
+    void reset(size_t expectedItems) {
+        capacity = max<uint64_t>(expectedItems, 64);
+        blockCount = blocksFor(capacity);
+        words.assign(blockCount * wordsPerBlock, 0);
+        itemCount = 0;
+    }
 
-            try {
-                item->fromFileString(data);
-                items.push_back(item);
-            } catch (...) {
-                cerr << "Error parsing line: " << line << endl;
-            }
+    void add(const string& id) {
+        uint64_t h = hashId(id);
+        uint64_t* block = &words[(h % blockCount) * wordsPerBlock];
+        uint64_t bits = mix(h);
+        // Кожна з 7 позицій бере 9 біт (0..511) у межах одного блоку
+        for (int i = 0; i < hashCount; ++i, bits >>= 9) {
+            block[(bits & 511) >> 6] |= 1ULL << (bits & 63);
         }
-        return items;
+        ++itemCount;
     }
 
-    void saveUserHistory(const User& user) {
-        ofstream file(usersFile, ios::app);
-        if (!file.is_open()) throw runtime_error("Cannot open file: " + usersFile);
-        user.saveToFile(file);
+    bool mayContain(const string& id) const {
+        if (blockCount == 0) return false;
+        uint64_t h = hashId(id);
+        const uint64_t* block = &words[(h % blockCount) * wordsPerBlock];
+        uint64_t bits = mix(h);
+        for (int i = 0; i < hashCount; ++i, bits >>= 9) {
+            if (!(block[(bits & 511) >> 6] & (1ULL << (bits & 63)))) return false;
+        }
+        return true;
     }
 
-    vector<string> loadUserHistory() {
-        vector<string> history;
-        ifstream file(usersFile);
-        if (!file.is_open()) return history;
+    bool needsGrow() const {
+        return itemCount > capacity;
+    }
 
-        string line;
-        while (getline(file, line)) history.push_back(line);
-        return history;
+    // Фільтр придатний без проходу по ID, якщо файл каталогу не змінювався після збереження
+    bool describes(uint64_t size, int64_t modified) const {
+        return catalogSize == size && catalogModified == modified;
+    }
+
+    void stamp(uint64_t size, int64_t modified) {
+        catalogSize = size;
+        catalogModified = modified;
+    }
+
+    void saveToFile(ofstream& file) const {
+        uint32_t magic = fileMagic;
+        uint64_t header[5] = { blockCount, itemCount, capacity, catalogSize, static_cast<uint64_t>(catalogModified) };
+        file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint64_t));
+    }
+
+    bool loadFromFile(ifstream& file) {
+        uint32_t magic = 0;
+        uint64_t header[5] = {};
+        file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        // Розмір масиву має відповідати місткості, інакше файл пошкоджений
+        if (!file || magic != fileMagic || header[2] < 64 || header[2] > maxCapacity ||
+            header[0] != blocksFor(header[2]) || header[1] > header[2]) return false;
+
+        // Весь масив читається одним блоком, без розбору рядків каталогу
+        vector<uint64_t> loaded(header[0] * wordsPerBlock);
+        file.read(reinterpret_cast<char*>(loaded.data()), loaded.size() * sizeof(uint64_t));
+        if (!file) return false;
+
+        words.swap(loaded);
+        blockCount = header[0];
+        itemCount = header[1];
+        capacity = header[2];
+        catalogSize = header[3];
+        catalogModified = static_cast<int64_t>(header[4]);
+        return true;
     }
 };
 
-// Основна система
-class LibrarySystem {
-    vector<shared_ptr<LibraryItem>> items;
-    unordered_set<string> usedIds;
-    FileManager fileManager;
-    User currentUser;
-    const string adminPassword = "admin123";
+// Точний індекс ID: номери елементів, впорядковані побайтово за ID.
+// Основний масив плюс невеликий буфер вставок, пошук - O(log n) в обох
+class IdIndex {
+    vector<uint32_t> base;
+    vector<uint32_t> delta;
 
-    void clearInput() {
-        cin.clear();
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    struct ById {
+        const vector<shared_ptr<LibraryItem>>& items;
+
+        bool operator()(uint32_t a, uint32_t b) const {
+            return items[a]->getId() < items[b]->getId();
+        }
+        bool operator()(uint32_t a, const string& id) const {
+            return items[a]->getId() < id;
+        }
+        bool operator()(const string& id, uint32_t b) const {
+            return id < items[b]->getId();
+        }
+    };
+
+    static bool find(const vector<uint32_t>& handles, const ById& less, const string& id, uint32_t& handle) {
+        auto it = lower_bound(handles.begin(), handles.end(), id, less);
+        if (it == handles.end() || less(id, *it)) return false;
+        handle = *it;
+        return true;
     }
 
-    int getIntInput(const string& prompt) {
-        int value;
-        while (true) {
-            cout << prompt;
-            if (cin >> value) {
-                clearInput();
-                return value;
-            }
-            clearInput();
-            cout << "Invalid input. Try again.\n";
+public:
+    void build(const vector<shared_ptr<LibraryItem>>& items) {
+        ById less{ items };
+        base.resize(items.size());
+        for (size_t i = 0; i < items.size(); ++i) {
+            base[i] = static_cast<uint32_t>(i);
+        }
+        sort(base.begin(), base.end(), less);
+        delta.clear();
+    }
+
+    void insert(const vector<shared_ptr<LibraryItem>>& items, uint32_t handle) {
+        ById less{ items };
+        delta.insert(upper_bound(delta.begin(), delta.end(), handle, less), handle);
+        size_t limit = max<size_t>(256, static_cast<size_t>(sqrt(static_cast<double>(base.size()))));
+        if (delta.size() > limit) {
+            vector<uint32_t> merged;
+            merged.reserve(base.size() + delta.size());
+            merge(base.begin(), base.end(), delta.begin(), delta.end(), back_inserter(merged), less);
+            base.swap(merged);
+            delta.clear();
         }
     }
 
+    // Номер елемента з таким ID; false, якщо його немає
+    bool find(const vector<shared_ptr<LibraryItem>>& items, const string& id, uint32_t& handle) const {
+        ById less{ items };
+        return find(base, less, id, handle) || find(delta, less, id, handle);
+    }
+
+    bool contains(const vector<shared_ptr<LibraryItem>>& items, const string& id) const {
+        uint32_t handle;
+        return find(items, id, handle);
+    }
+};
+
+// Лічильники каталогу, що оновлюються при кожній зміні, а не перерахунком
+class CatalogStats {
+    size_t totalItems = 0;
+    size_t books = 0;
+    size_t magazines = 0;
+    size_t borrowedBooks = 0;
+    size_t totalBorrows = 0;
+    size_t authors = 0;
+    unordered_map<string, size_t> itemsPerAuthor;
+    unordered_map<uint64_t, size_t> borrowsPerReader;
+
 public:
-    LibrarySystem() {
-        items = fileManager.loadItems();
+    void onItemAdded(const LibraryItem& item) {
+        ++totalItems;
+        if (++itemsPerAuthor[item.getAuthor()] == 1) ++authors;
+        if (auto book = dynamic_cast<const Book*>(&item)) {
+            ++books;
+            if (book->getBorrowedStatus()) ++borrowedBooks;
+        } else if (dynamic_cast<const Magazine*>(&item)) {
+            ++magazines;
+        }
+    }
+
+    void onBorrow(const LibraryItem& item, uint64_t readerId) {
+        ++totalBorrows;
+        ++borrowsPerReader[readerId];
+        if (dynamic_cast<const Book*>(&item)) ++borrowedBooks;
+    }
+
+    void onReturn(const LibraryItem& item) {
+        if (dynamic_cast<const Book*>(&item) && borrowedBooks > 0) --borrowedBooks;
+    }
+
+    // У спільному режимі підсумки каталогу беруться з лічильників сегмента,
+    // а списки за авторами там не дублюються
+    void setCatalogTotals(size_t bookCount, size_t magazineCount, size_t borrowedCount, size_t authorTotal) {
+        books = bookCount;
+        magazines = magazineCount;
+        totalItems = bookCount + magazineCount;
+        borrowedBooks = borrowedCount;
+        authors = authorTotal;
+    }
+
+    // Лічильники за станом каталогу (позичання за читачами сюди не входять)
+    static CatalogStats recompute(const vector<shared_ptr<LibraryItem>>& items) {
+        CatalogStats stats;
         for (const auto& item : items) {
-            usedIds.insert(item->getId());
+            stats.onItemAdded(*item);
         }
+        return stats;
     }
 
-    ~LibrarySystem() {
-        fileManager.saveItems(items);
+    bool sameTotals(const CatalogStats& other) const {
+        return totalItems == other.totalItems && books == other.books &&
+               magazines == other.magazines && borrowedBooks == other.borrowedBooks &&
+               authors == other.authors;
     }
 
-    void run() {
-        while (true) {
-            cout << "\n=== Library System ===\n";
-            cout << "1. Login as Admin\n";
-            cout << "2. Login as User\n";
-            cout << "3. View User History\n";
-            cout << "4. Exit\n";
+    bool sameCatalogCounters(const CatalogStats& other) const {
+        return sameTotals(other) && itemsPerAuthor == other.itemsPerAuthor;
+    }
 
-            int choice = getIntInput("Choose option: ");
-            try {
-                switch (choice) {
-                    case 1: adminMenu(); break;
-                    case 2: userMenu(); break;
-                    case 3: viewHistory(); break;
-                    case 4: return;
-                    default: cout << "Invalid choice!\n";
-                }
-            } catch (const exception& e) {
-                cerr << "Error: " << e.what() << endl;
-            }
+    // Порівняння кількостей за авторами з іншим джерелом, countOf(author) -> size_t
+    template <typename Lookup>
+    bool authorsMatch(Lookup countOf) const {
+        for (const auto& entry : itemsPerAuthor) {
+            if (countOf(entry.first) != entry.second) return false;
         }
+        return true;
     }
 
-    void adminMenu() {
-        cout << "Enter admin password: ";
-        string pass;
-        getline(cin, pass);
-        if (pass != adminPassword) {
-            cout << "Incorrect password.\n";
-            return;
+    size_t authorCount(const string& author) const {
+        auto it = itemsPerAuthor.find(author);
+        return it == itemsPerAuthor.end() ? 0 : it->second;
+    }
+
+    // Лише підсумкові лічильники, тому O(1) незалежно від розміру каталогу
+    void display(ostream& out) const {
+        out << "Total items: " << totalItems << endl;
+        out << "Books: " << books << ", Magazines: " << magazines << endl;
+        out << "Borrowed books: " << borrowedBooks
+            << ", Available items: " << totalItems - borrowedBooks << endl;
+        out << "Authors: " << authors << endl;
+        out << "Borrows this session: " << totalBorrows << endl;
+    }
+
+    // Повні списки за авторами і читачами - O(кількість авторів + читачів)
+    void displayDetails(ostream& out) const {
+        out << "Items per author:\n";
+        for (const auto& entry : itemsPerAuthor) {
+            out << "  " << entry.first << ": " << entry.second << endl;
         }
+        displayReaders(out);
+    }
 
-        while (true) {
-            cout << "\n=== Admin Menu ===\n";
-            cout << "1. Add Book\n";
-            cout << "2. Add Magazine\n";
-            cout << "3. List All Items\n";
-            cout << "4. Back\n";
+    void displayReaders(ostream& out) const {
+        out << "Borrows per reader this session:\n";
+        for (const auto& entry : borrowsPerReader) {
+            out << "  Reader " << entry.first << ": " << entry.second << endl;
+        }
+    }
+};
 
-            int choice = getIntInput("Choose option: ");
-            switch (choice) {
-                case 1: addBook(); break;
-                case 2: addMagazine(); break;
-                case 3: listItems(); break;
-                case 4: return;
-                default: cout << "Invalid option.\n";
-            }
+// Ключ впорядкування для змішаного латинсько-кириличного тексту (UTF-8):
+// регістр не враховується, цифри йдуть перед латиницею, латиниця перед кирилицею
+u32string collationKey(const string& text) {
+    static const char32_t cyrillicOrder[] = {
+        0x430, 0x431, 0x432, 0x433, 0x491, 0x434, 0x435, 0x451, 0x454, 0x436, 0x437,
+        0x438, 0x456, 0x457, 0x439, 0x43A, 0x43B, 0x43C, 0x43D, 0x43E, 0x43F, 0x440,
+        0x441, 0x442, 0x443, 0x444, 0x445, 0x446, 0x447, 0x448, 0x449, 0x44A, 0x44B,
+        0x44C, 0x44D, 0x44E, 0x44F
+    };
+    const size_t cyrillicCount = sizeof(cyrillicOrder) / sizeof(cyrillicOrder[0]);
+
+    u32string key;
+    key.reserve(text.size());
+    for (size_t i = 0; i < text.size();) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        char32_t cp;
+        size_t length;
+        if (c < 0x80) { cp = c; length = 1; }
+        else if ((c >> 5) == 0x6) { cp = c & 0x1F; length = 2; }
+        else if ((c >> 4) == 0xE) { cp = c & 0x0F; length = 3; }
+        else if ((c >> 3) == 0x1E) { cp = c & 0x07; length = 4; }
+        else { cp = c; length = 1; }
+        if (i + length > text.size()) length = 1;
+        for (size_t k = 1; k < length; ++k) {
+            cp = (cp << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+        }
+        i += length;
+
+        if (cp >= 'A' && cp <= 'Z') cp += 'a' - 'A';
+        else if (cp >= 0x410 && cp <= 0x42F) cp += 0x20;
+        else if (cp >= 0x400 && cp <= 0x40F) cp += 0x50;
+        else if (cp == 0x490) cp = 0x491;
+
+        if (cp >= '0' && cp <= '9') key.push_back(0x100 + (cp - '0'));
+        else if (cp >= 'a' && cp <= 'z') key.push_back(0x200 + (cp - 'a'));
+        else {
+            const char32_t* pos = find(cyrillicOrder, cyrillicOrder + cyrillicCount, cp);
+            if (pos != cyrillicOrder + cyrillicCount) key.push_back(0x300 + static_cast<char32_t>(pos - cyrillicOrder));
+            else if (cp < 0x80) key.push_back(cp);  // пробіли та розділові знаки - першими
+            else key.push_back(0x1000 + cp);
         }
     }
+    return key;
+}
 
-    void userMenu() {
-        cout << "Enter your name: ";
-        string name;
-        getline(cin, name);
-        currentUser = User(name);
+// Сортування частин у кількох потоках з подальшим попарним злиттям
+template <typename T>
+void parallelSort(vector<T>& data) {
+    size_t threads = max<size_t>(1, min<size_t>(thread::hardware_concurrency(), 8));
+    if (data.size() < 16384 || threads == 1) {
+        sort(data.begin(), data.end());
+        return;
+    }
 
-        while (true) {
-            cout << "\n=== User Menu (" << name << ") ===\n";
-            cout << "1. Browse Items\n";
-            cout << "2. Borrow Item\n";
-            cout << "3. View My Borrowed Items\n";
-            cout << "4. Back to Main Menu\n";
+    vector<size_t> bounds;
+    for (size_t t = 0; t <= threads; ++t) {
+        bounds.push_back(data.size() * t / threads);
+    }
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&data, &bounds, t]() {
+            sort(data.begin() + bounds[t], data.begin() + bounds[t + 1]);
+        });
+    }
+    for (thread& worker : workers) worker.join();
 
-            int choice = getIntInput("Choose option: ");
-            switch (choice) {
-                case 1: listItems(); break;
-                case 2: borrowItem(); break;
-                case 3: currentUser.displayBorrowed(); break;
-                case 4:
-                    fileManager.saveUserHistory(currentUser);
-                    return;
-                default: cout << "Invalid option.\n";
-            }
+    for (size_t width = 1; width < threads; width *= 2) {
+        workers.clear();
+        for (size_t t = 0; t + width < threads; t += 2 * width) {
+            size_t first = bounds[t];
+            size_t middle = bounds[t + width];
+            size_t last = bounds[min(t + 2 * width, threads)];
+            workers.emplace_back([&data, first, middle, last]() {
+                inplace_merge(data.begin() + first, data.begin() + middle, data.begin() + last);
+            });
         }
+        for (thread& worker : workers) worker.join();
     }
+}
 
-    void viewHistory() {
-        auto history = fileManager.loadUserHistory();
-        if (history.empty()) {
-            cout << "No user history found.\n";
-            return;
+// Впорядкований індекс: великий відсортований масив і невеликий відсортований буфер вставок
+class OrderedView {
+public:
+    struct Entry {
+        u32string key;
+        uint32_t handle;
+
+        bool operator<(const Entry& other) const {
+            int cmp = key.compare(other.key);
+            return cmp != 0 ? cmp < 0 : handle < other.handle;
         }
+    };
 
-        cout << "\n=== User History ===\n";
-        for (const string& entry : history) {
-            cout << entry << endl;
+private:
+    vector<Entry> base;
+    vector<Entry> delta;
+
+    // Скільки з перших position елементів лежить у буфері вставок
+    size_t deltaBefore(size_t position) const {
+        size_t lo = position > base.size() ? position - base.size() : 0;
+        size_t hi = min(position, delta.size());
+        while (lo < hi) {
+            size_t i = lo + (hi - lo) / 2;
+            size_t j = position - i;
+            if (j > 0 && delta[i] < base[j - 1]) lo = i + 1;
+            else hi = i;
         }
+        return lo;
     }
 
-    void addBook() {
-        string title, author, id, isbn;
-        cout << "Enter title: "; getline(cin, title);
-        cout << "Enter author: "; getline(cin, author);
-        cout << "Enter ID: "; getline(cin, id);
-        if (usedIds.count(id)) {
-            cout << "ID already exists!\n";
-            return;
+public:
+    void build(vector<Entry> entries) {
+        parallelSort(entries);
+        base.swap(entries);
+        delta.clear();
+    }
+
+    // Буфер зливається з основним масивом, коли виростає понад ~sqrt(n)
+    void insert(Entry entry) {
+        delta.insert(upper_bound(delta.begin(), delta.end(), entry), std::move(entry));
+        size_t limit = max<size_t>(256, static_cast<size_t>(sqrt(static_cast<double>(base.size()))));
+        if (delta.size() > limit) {
+            vector<Entry> merged;
+            merged.reserve(base.size() + delta.size());
+            merge(make_move_iterator(base.begin()), make_move_iterator(base.end()),
+                  make_move_iterator(delta.begin()), make_move_iterator(delta.end()),
+                  back_inserter(merged));
+            base.swap(merged);
+            delta.clear();
         }
-        cout << "Enter ISBN: "; getline(cin, isbn);
+    }
 
-        items.push_back(make_shared<Book>(title, author, id, isbn));
-        usedIds.insert(id);
-        cout << "Book added.\n";
+    size_t size() const {
+        return base.size() + delta.size();
     }
 
-    void addMagazine() {
-        string title, author, id;
-        cout << "Enter title: "; getline(cin, title);
-        cout << "Enter author: "; getline(cin, author);
-        cout << "Enter ID: "; getline(cin, id);
-        if (usedIds.count(id)) {
-            cout << "ID already exists!\n";
-            return;
+    // Позиція першого елемента, не меншого за ключ
+    size_t rank(const u32string& key) const {
+        Entry probe{ key, 0 };
+        return static_cast<size_t>(lower_bound(base.begin(), base.end(), probe) - base.begin()) +
+               static_cast<size_t>(lower_bound(delta.begin(), delta.end(), probe) - delta.begin());
+    }
+
+    // Номери елементів каталогу на позиціях [position, position + count)
+    vector<uint32_t> page(size_t position, size_t count) const {
+        vector<uint32_t> handles;
+        if (position >= size()) return handles;
+        size_t d = deltaBefore(position);
+        size_t b = position - d;
+        while (handles.size() < count && (b < base.size() || d < delta.size())) {
+            if (d == delta.size() || (b < base.size() && base[b] < delta[d])) handles.push_back(base[b++].handle);
+            else handles.push_back(delta[d++].handle);
         }
-        int issue = getIntInput("Enter issue number: ");
+        return handles;
+    }
+};
 
-        items.push_back(make_shared<Magazine>(title, author, id, issue));
-        usedIds.insert(id);
-        cout << "Magazine added.\n";
+// Порядки перегляду каталогу
+enum class ViewOrder { Title, Author, Id };
+
+// Поля елемента, за якими будуються подання
+struct ViewFields {
+    string title;
+    string author;
+    string id;
+};
+
+// Впорядковані подання каталогу за назвою, автором та ID
+class CatalogViews {
+    static const uint32_t noHandle = 0xFFFFFFFF;
+
+    OrderedView byTitle;
+    OrderedView byAuthor;
+    OrderedView byId;
+
+    static OrderedView::Entry entryFor(ViewOrder order, const ViewFields& fields, uint32_t handle) {
+        switch (order) {
+            case ViewOrder::Title: return { collationKey(fields.title), handle };
+            // Книги одного автора додатково впорядковані за назвою
+            case ViewOrder::Author: return { collationKey(fields.author) + U'\0' + collationKey(fields.title), handle };
+            default: return { collationKey(fields.id), handle };
+        }
     }
 
-    void listItems() const {
-        if (items.empty()) {
-            cout << "No items available.\n";
-            return;
+public:
+    // source(i, fields) заповнює поля елемента з номером i; false - елемента немає
+    template <typename Source>
+    void build(size_t count, Source source) {
+        vector<OrderedView::Entry> titles(count), authors(count), ids(count);
+        auto fill = [&](size_t first, size_t last) {
+            ViewFields fields;
+            for (size_t i = first; i < last; ++i) {
+                uint32_t handle = static_cast<uint32_t>(i);
+                if (!source(i, fields)) {
+                    titles[i].handle = authors[i].handle = ids[i].handle = noHandle;
+                    continue;
+                }
+                titles[i] = entryFor(ViewOrder::Title, fields, handle);
+                authors[i] = entryFor(ViewOrder::Author, fields, handle);
+                ids[i] = entryFor(ViewOrder::Id, fields, handle);
+            }
+        };
+        // Ключі впорядкування рахуються паралельно частинами з того ж порогу, що й у parallelSort;
+        // поля кожного елемента читаються один раз
+        size_t threads = max<size_t>(1, min<size_t>(thread::hardware_concurrency(), 8));
+        if (count < 16384 || threads == 1) {
+            fill(0, count);
+        } else {
+            vector<thread> workers;
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back(fill, count * t / threads, count * (t + 1) / threads);
+            }
+            for (thread& worker : workers) worker.join();
         }
-        cout << "\n=== Available Items ===\n";
-        for (size_t i = 0; i < items.size(); ++i) {
-            cout << i + 1 << ". ";
-            items[i]->display();
+
+        auto absent = [](const OrderedView::Entry& entry) { return entry.handle == noHandle; };
+        for (vector<OrderedView::Entry>* entries : { &titles, &authors, &ids }) {
+            entries->erase(remove_if(entries->begin(), entries->end(), absent), entries->end());
         }
+        byTitle.build(std::move(titles));
+        byAuthor.build(std::move(authors));
+        byId.build(std::move(ids));
     }
 
-    void borrowItem() {
-        listItems();
-        if (items.empty()) return;
+    void insert(const ViewFields& fields, uint32_t handle) {
+        byTitle.insert(entryFor(ViewOrder::Title, fields, handle));
+        byAuthor.insert(entryFor(ViewOrder::Author, fields, handle));
+        byId.insert(entryFor(ViewOrder::Id, fields, handle));
+    }
 
-        int idx = getIntInput("Enter item number to borrow (0 to cancel): ");
-        if (idx == 0) return;
-        if (idx < 1 || idx > static_cast<int>(items.size())) {
-            cout << "Invalid number.\n";
-            return;
+    OrderedView& view(ViewOrder order) {
+        switch (order) {
+            case ViewOrder::Title: return byTitle;
+            case ViewOrder::Author: return byAuthor;
+            default: return byId;
         }
-
-        currentUser.borrowItem(items[idx - 1]);
     }
 };
 
-int main() {
-    try {
-        LibrarySystem system;
+// Резерв читача на зайняту книгу
+struct Hold {
+    string itemId;
+    string patron;
+    time_t expiresAt;
+    bool ready;     // книгу повернули, і вона чекає саме на цього читача
+    size_t slot;    // слот колеса таймерів, де зараз запланований резерв
+};
+
+// Черги резервувань: FIFO на кожну книгу, застарілі резерви знімає колесо таймерів
+class HoldManager {
+    static const time_t queueTtl = 14 * 24 * 3600;
+    static const time_t pickupTtl = 3 * 24 * 3600;
+    static const time_t tickSeconds = 60;
+    static const size_t wheelSize = 4096;
+
+    unordered_map<uint64_t, Hold> holds;
+    unordered_map<string, deque<uint64_t>> queues;  // номери резервів у порядку черги
+    unordered_map<string, uint64_t> readyHolds;     // книга -> резерв, що чекає видачі
+    unordered_map<string, uint64_t> patronHolds;    // "книга|читач" -> резерв
+    vector<vector<uint64_t>> wheel;
+    uint64_t nextSeq = 1;
+    time_t lastTick;
+
+    static string patronKey(const string& itemId, const string& patron) {
+        return itemId + "|" + patron;
+    }
+
+    void schedule(uint64_t seq, Hold& hold) {
+        // Резерв ніколи не потрапляє в уже пройдений слот
+        time_t tick = hold.expiresAt / tickSeconds;
+        if (tick <= lastTick) tick = lastTick + 1;
+        hold.slot = static_cast<size_t>(tick % wheelSize);
+        wheel[hold.slot].push_back(seq);
+    }
+
+    uint64_t insert(const string& itemId, const string& patron, time_t expiresAt, bool ready) {
+        uint64_t seq = nextSeq++;
+        Hold& hold = holds[seq];
+        hold = Hold{ itemId, patron, expiresAt, ready, 0 };
+        schedule(seq, hold);
+        patronHolds[patronKey(itemId, patron)] = seq;
+        if (ready) readyHolds[itemId] = seq;
+        else queues[itemId].push_back(seq);
+        return seq;
+    }
+
+    void erase(uint64_t seq) {
+        auto it = holds.find(seq);
+        if (it == holds.end()) return;
+        const string& itemId = it->second.itemId;
+        patronHolds.erase(patronKey(itemId, it->second.patron));
+        if (it->second.ready) {
+            readyHolds.erase(itemId);
+        } else {
+            // Знятий резерв одразу прибирається з черги, щоб вона не росла від застарілих номерів
+            auto qit = queues.find(itemId);
+            if (qit != queues.end()) {
+                deque<uint64_t>& queue = qit->second;
+                auto pos = find(queue.begin(), queue.end(), seq);
+                if (pos != queue.end()) queue.erase(pos);
+                if (queue.empty()) queues.erase(qit);
+            }
+        }
+        holds.erase(it);
+    }
+
+    void processSlot(size_t slot, time_t now) {
+        vector<uint64_t> pending;
+        pending.swap(wheel[slot]);
+        for (uint64_t seq : pending) {
+            auto it = holds.find(seq);
+            // Знятий або перенесений в інший слот резерв просто відкидається
+            if (it == holds.end() || it->second.slot != slot) continue;
+            if (it->second.expiresAt > now) {
+                wheel[slot].push_back(seq);
+                continue;
+            }
+            string itemId = it->second.itemId;
+            bool wasReady = it->second.ready;
+            erase(seq);
+            if (wasReady) handOff(itemId, now);
+        }
+    }
+
+public:
+    HoldManager() : wheel(wheelSize), lastTick(time(nullptr) / tickSeconds) {}
+
+    // Ставить читача в кінець черги; false, якщо резерв уже існує
+    bool place(const string& itemId, const string& patron, time_t now) {
+        if (patronHolds.count(patronKey(itemId, patron))) return false;
+        insert(itemId, patron, now + queueTtl, false);
+        return true;
+    }
+
+    // Передає повернену книгу першому читачу з черги; повертає його ім'я або ""
+    string handOff(const string& itemId, time_t now) {
+        auto qit = queues.find(itemId);
+        if (qit == queues.end()) return "";
+
+        deque<uint64_t>& queue = qit->second;
+        string patron;
+        while (!queue.empty() && patron.empty()) {
+            auto it = holds.find(queue.front());
+            queue.pop_front();
+            if (it == holds.end()) continue;
+
+            Hold& hold = it->second;
+            hold.ready = true;
+            hold.expiresAt = now + pickupTtl;
+            schedule(it->first, hold);
+            readyHolds[itemId] = it->first;
+            patron = hold.patron;
+        }
+        if (queue.empty()) queues.erase(qit);
+        return patron;
+    }
+
+    // Читач, для якого відкладена книга, або ""
+    string reservedFor(const string& itemId) const {
+        auto it = readyHolds.find(itemId);
+        if (it == readyHolds.end()) return "";
+        return holds.at(it->second).patron;
+    }
+
+    // Знімає відкладений резерв, коли читач забирає книгу
+    void fulfill(const string& itemId) {
+        auto it = readyHolds.find(itemId);
+        if (it != readyHolds.end()) erase(it->second);
+    }
+
+    void expire(time_t now) {
+        time_t nowTick = now / tickSeconds;
+        if (nowTick <= lastTick) return;
+        time_t steps = min<time_t>(nowTick - lastTick, static_cast<time_t>(wheelSize));
+        time_t from = lastTick;
+        lastTick = nowTick;
+        for (time_t t = from + 1; t <= from + steps; ++t) {
+            processSlot(static_cast<size_t>(t % wheelSize), now);
+        }
+    }
+
+    // Відновлення з файлу; прострочені резерви в черзі не відновлюються
+    void restore(const string& itemId, const string& patron, time_t expiresAt, bool ready, time_t now) {
+        if (!ready && expiresAt <= now) return;
+        if (patronHolds.count(patronKey(itemId, patron))) return;
+        if (ready && readyHolds.count(itemId)) return;
+        insert(itemId, patron, expiresAt, ready);
+    }
+
+    void saveToFile(ostream& file) const {
+        for (const auto& entry : readyHolds) {
+            const Hold& hold = holds.at(entry.second);
+            file << "HOLD|" << hold.itemId << "|" << hold.patron << "|"
+                 << static_cast<long long>(hold.expiresAt) << "|1\n";
+        }
+        for (const auto& entry : queues) {
+            for (uint64_t seq : entry.second) {
+                auto it = holds.find(seq);
+                if (it == holds.end()) continue;
+                file << "HOLD|" << it->second.itemId << "|" << it->second.patron << "|"
+                     << static_cast<long long>(it->second.expiresAt) << "|0\n";
+            }
+        }
+    }
+};
+
+// Запис читача: поточні позики зберігаються як ID елементів, бо номери в каталозі
+// залежать від порядку завантаження і різні в різних процесах
+struct ReaderRecord {
+    string name;
+    vector<string> loans;
+};
+
+// Реєстр читачів за ID; вхід у сесію - один пошук у хеш-таблиці
+class ReaderRegistry {
+    unordered_map<uint64_t, ReaderRecord> readers;
+    mutable mutex guard;
+    atomic<uint64_t> nextId{ 1 };
+    atomic<size_t> activeSessions{ 0 };
+
+public:
+    uint64_t registerReader(const string& name) {
+        uint64_t id = nextId.fetch_add(1);
+        lock_guard<mutex> lock(guard);
+        readers[id].name = name;
+        return id;
+    }
+
+    // Копія запису, щоб інші сесії могли змінювати реєстр паралельно
+    bool find(uint64_t id, ReaderRecord& record) const {
+        lock_guard<mutex> lock(guard);
+        auto it = readers.find(id);
+        if (it == readers.end()) return false;
+        record = it->second;
+        return true;
+    }
+
+    // Порядок позик збігається з порядком у User::borrowedItems
+    void addLoan(uint64_t id, const string& itemId) {
+        lock_guard<mutex> lock(guard);
+        readers.at(id).loans.push_back(itemId);
+    }
+
+    void removeLoanAt(uint64_t id, size_t index) {
+        lock_guard<mutex> lock(guard);
+        vector<string>& loans = readers.at(id).loans;
+        if (index < loans.size()) loans.erase(loans.begin() + index);
+    }
+
+    void beginSession() {
+        ++activeSessions;
+    }
+
+    void endSession() {
+        --activeSessions;
+    }
+
+    size_t sessionCount() const {
+        return activeSessions.load();
+    }
+
+    size_t size() const {
+        lock_guard<mutex> lock(guard);
+        return readers.size();
+    }
+
+    void reserve(size_t count) {
+        lock_guard<mutex> lock(guard);
+        readers.reserve(count);
+    }
+
+    void restore(uint64_t id, const string& name, const vector<string>& loans) {
+        lock_guard<mutex> lock(guard);
+        ReaderRecord& record = readers[id];
+        record.name = name;
+        record.loans = loans;
+        uint64_t next = nextId.load();
+        while (next <= id && !nextId.compare_exchange_weak(next, id + 1)) {}
+    }
+
+    static string formatLine(uint64_t id, const ReaderRecord& record) {
+        string line = "READER|" + to_string(id) + "|" + record.name;
+        for (const string& loan : record.loans) {
+            line += "|" + loan;
+        }
+        return line;
+    }
+
+    void saveToFile(ostream& file) const {
+        lock_guard<mutex> lock(guard);
+        file << "COUNT|" << readers.size() << "\n";
+        for (const auto& entry : readers) {
+            file << formatLine(entry.first, entry.second) << "\n";
+        }
+    }
+};
+
+// Робота з файлами
+class FileManager {
+    const string itemsFile = "library_items.dat";
+    const string usersFile = "users_history.dat";
+    const string idFilterFile = "library_ids.bloom";
+    const string holdsFile = "holds.dat";
+    const string readersFile = "readers.dat";
+
+public:
+    // Розбір і запис форматів окремо від файлів, щоб ті самі рядки йшли й у знімок траси
+    static void writeItems(ostream& file, const vector<shared_ptr<LibraryItem>>& items) {
+        for (const auto& item : items) {
+            string type;
+            if (dynamic_cast<Book*>(item.get())) type = "BOOK|";
+            else if (dynamic_cast<Magazine*>(item.get())) type = "MAGAZINE|";
+            file << type << item->toFileString() << "\n";
+        }
+    }
+
+    void saveItems(const vector<shared_ptr<LibraryItem>>& items) {
+        ofstream file(itemsFile);
+        if (!file.is_open()) throw runtime_error("Cannot open file: " + itemsFile);
+        writeItems(file, items);
+    }
+
+    vector<shared_ptr<LibraryItem>> loadItems() {
+        ifstream file(itemsFile);
+        if (!file.is_open()) return {};
+        return readItems(file);
+    }
+
+    static vector<shared_ptr<LibraryItem>> readItems(istream& file) {
+        vector<shared_ptr<LibraryItem>> items;
+        string line;
+        while (getline(file, line)) {
+            size_t pos = line.find('|');
+            if (pos == string::npos) continue;
+
+            string type = line.substr(0, pos);
+            string data = line.substr(pos + 1);
+
+            shared_ptr<LibraryItem> item;
+            if (type == "BOOK") item = make_shared<Book>();
+            else if (type == "MAGAZINE") item = make_shared<Magazine>();
+            else continue;
+
+            try {
+                item->fromFileString(data);
+                items.push_back(item);
+            } catch (...) {
+                cerr << "Error parsing line: " << line << endl;
+            }
+        }
+        return items;
+    }
+
+    void saveIdFilter(const IdFilter& filter) {
+        ofstream file(idFilterFile, ios::binary);
+        if (!file.is_open()) throw runtime_error("Cannot open file: " + idFilterFile);
+        filter.saveToFile(file);
+    }
+
+    bool loadIdFilter(IdFilter& filter) {
+        ifstream file(idFilterFile, ios::binary);
+        if (!file.is_open()) return false;
+        return filter.loadFromFile(file);
+    }
+
+    void saveHolds(const HoldManager& holds) {
+        ofstream file(holdsFile);
+        if (!file.is_open()) throw runtime_error("Cannot open file: " + holdsFile);
+        holds.saveToFile(file);
+    }
+
+    // Розмір і час зміни файлу каталогу; false, якщо файлу немає
+    bool itemsStamp(uint64_t& size, int64_t& modified) const {
+#ifdef _WIN32
+        struct _stat64 st;
+        if (_stat64(itemsFile.c_str(), &st) != 0) return false;
+        modified = static_cast<int64_t>(st.st_mtime) * 1000000000LL;
+#else
+        struct stat st;
+        if (stat(itemsFile.c_str(), &st) != 0) return false;
+#if defined(__linux__)
+        modified = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#else
+        modified = static_cast<int64_t>(st.st_mtime) * 1000000000LL;
+#endif
+#endif
+        size = static_cast<uint64_t>(st.st_size);
+        return true;
+    }
+
+    void loadHolds(HoldManager& holds) {
+        ifstream file(holdsFile);
+        if (file.is_open()) readHolds(file, holds);
+    }
+
+    static void readHolds(istream& file, HoldManager& holds) {
+        time_t now = time(nullptr);
+        string line;
+        while (getline(file, line)) {
+            vector<string> parts;
+            size_t start = 0, end;
+            while ((end = line.find('|', start)) != string::npos) {
+                parts.push_back(line.substr(start, end - start));
+                start = end + 1;
+            }
+            parts.push_back(line.substr(start));
+            if (parts.size() != 5 || parts[0] != "HOLD") continue;
+
+            try {
+                holds.restore(parts[1], parts[2], static_cast<time_t>(stoll(parts[3])), parts[4] == "1", now);
+            } catch (...) {
+                cerr << "Error parsing line: " << line << endl;
+            }
+        }
+    }
+
+    // Розбір рядка READER|id|ім'я|позики...; false для інших рядків
+    static bool parseReader(const string& line, uint64_t& id, ReaderRecord& record) {
+        vector<string> parts;
+        size_t start = 0, end;
+        while ((end = line.find('|', start)) != string::npos) {
+            parts.push_back(line.substr(start, end - start));
+            start = end + 1;
+        }
+        parts.push_back(line.substr(start));
+        if (parts.size() < 3 || parts[0] != "READER") return false;
+
+        id = stoull(parts[1]);
+        record.name = parts[2];
+        record.loans.clear();
+        for (size_t i = 3; i < parts.size(); ++i) {
+            if (!parts[i].empty()) record.loans.push_back(parts[i]);
+        }
+        return true;
+    }
+
+    // Дописує запис у журнал одним записом і повертає зсув його початку
+    uint64_t appendReader(const string& line) {
+        ofstream file(readersFile, ios::binary | ios::app);
+        if (!file.is_open()) throw runtime_error("Cannot open file: " + readersFile);
+        string entry = line + "\n";
+        file.write(entry.data(), entry.size());
+        file.flush();
+        streamoff end = file.tellp();
+        if (!file || end < static_cast<streamoff>(entry.size())) throw runtime_error("Cannot write file: " + readersFile);
+        return static_cast<uint64_t>(end) - entry.size();
+    }
+
+    // Запис читача id, що починається з байта offset журналу
+    bool readReaderAt(istream& file, uint64_t offset, uint64_t id, ReaderRecord& record) const {
+        file.clear();
+        file.seekg(static_cast<streamoff>(offset));
+        string line;
+        if (!getline(file, line)) return false;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        uint64_t parsedId = 0;
+        try {
+            return parseReader(line, parsedId, record) && parsedId == id;
+        } catch (...) {
+            return false;
+        }
+    }
+
+    bool readReaderAt(uint64_t offset, uint64_t id, ReaderRecord& record) const {
+        ifstream file(readersFile, ios::binary);
+        return file.is_open() && readReaderAt(file, offset, id, record);
+    }
+
+    // Обходить журнал і повідомляє visit(id, зсув) для кожного запису; пізніший перекриває ранній
+    template <typename Visit>
+    void scanReaders(Visit visit) const {
+        ifstream file(readersFile, ios::binary);
+        if (!file.is_open()) return;
+
+        uint64_t offset = 0;
+        string line;
+        ReaderRecord record;
+        while (getline(file, line)) {
+            uint64_t lineOffset = offset;
+            offset += line.size() + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            try {
+                uint64_t id;
+                if (parseReader(line, id, record)) visit(id, lineOffset);
+            } catch (...) {
+                cerr << "Error parsing line: " << line << endl;
+            }
+        }
+    }
+
+    // Знімок журналу зі спільного режиму: для кожного ID береться запис за зсувом
+    // з таблиці сегмента, offsetOf(id) -> зсув + 1 або 0
+    template <typename OffsetOf>
+    void compactReaders(uint64_t nextId, OffsetOf offsetOf) {
+        ReaderRegistry registry;
+        {
+            ifstream file(readersFile, ios::binary);
+            if (!file.is_open()) return;
+            ReaderRecord record;
+            for (uint64_t id = 1; id < nextId; ++id) {
+                uint64_t entry = offsetOf(id);
+                if (entry != 0 && readReaderAt(file, entry - 1, id, record)) {
+                    registry.restore(id, record.name, record.loans);
+                }
+            }
+        }
+        saveReaders(registry);
+    }
+
+    void saveReaders(const ReaderRegistry& registry) {
+        ofstream file(readersFile);
+        if (!file.is_open()) throw runtime_error("Cannot open file: " + readersFile);
+        registry.saveToFile(file);
+    }
+
+    void loadReaders(ReaderRegistry& registry) {
+        ifstream file(readersFile);
+        if (file.is_open()) readReaders(file, registry);
+    }
+
+    static void readReaders(istream& file, ReaderRegistry& registry) {
+        string line;
+        while (getline(file, line)) {
+            try {
+                if (line.compare(0, 6, "COUNT|") == 0) {
+                    registry.reserve(stoull(line.substr(6)));
+                    continue;
+                }
+                uint64_t id;
+                ReaderRecord record;
+                if (parseReader(line, id, record)) registry.restore(id, record.name, record.loans);
+            } catch (...) {
+                cerr << "Error parsing line: " << line << endl;
+            }
+        }
+    }
+
+    void saveUserHistory(const User& user) {
+        ofstream file(usersFile, ios::app);
+        if (!file.is_open()) throw runtime_error("Cannot open file: " + usersFile);
+        user.saveToFile(file);
+    }
+
+    vector<string> loadUserHistory() {
+        vector<string> history;
+        ifstream file(usersFile);
+        if (!file.is_open()) return history;
+
+        string line;
+        while (getline(file, line)) history.push_back(line);
+        return history;
+    }
+};
+
+// Рядок у спільній пам'яті: зсув від початку сегмента замість вказівника
+struct SharedString {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t reserved;
+};
+
+// Запис каталогу в сегменті; published = 1 лише після повного запису, 2 - слот зіпсований
+// або ID виявився зайнятим
+struct SharedRecord {
+    atomic<uint32_t> published;
+    atomic<uint32_t> borrowed;
+    uint32_t type;
+    int32_t issue;
+    SharedString title;
+    SharedString author;
+    SharedString id;
+    SharedString isbn;
+};
+
+// Слот таблиці авторів: перший запис цього автора і кількість його елементів
+struct SharedAuthorSlot {
+    atomic<uint64_t> record;  // номер запису + 1, 0 - вільний слот
+    atomic<uint64_t> count;
+};
+
+struct SharedHeader {
+    uint32_t magic;
+    uint32_t version;
+    atomic<uint32_t> state;
+    atomic<uint32_t> ownerPid;
+    uint64_t capacity;
+    uint64_t tableSize;           // слотів у таблицях ID та авторів
+    uint64_t recordsOffset;
+    uint64_t idTableOffset;
+    uint64_t authorTableOffset;
+    uint64_t readerTableOffset;   // зсув останнього запису кожного читача в readers.dat
+    uint64_t readerCapacity;
+    uint64_t arenaOffset;
+    uint64_t arenaSize;
+    atomic<uint64_t> recordCount;
+    atomic<uint64_t> arenaUsed;
+    atomic<uint64_t> bookCount;
+    atomic<uint64_t> magazineCount;
+    atomic<uint64_t> authorCount;
+    atomic<uint64_t> borrowedCount;
+    atomic<uint32_t> dirty;       // каталог змінено після побудови
+    uint32_t reserved;
+    atomic<uint64_t> nextReaderId; // спільний лічильник ID читачів
+    atomic<uint64_t> readerCount;
+    uint64_t fileSize;            // відбиток library_items.dat, з якого побудовано сегмент
+    int64_t fileModified;
+    atomic<uint32_t> attached[64]; // PID підключених процесів, 0 - вільний слот
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+              "Shared catalog requires lock-free atomics");
+
+// Іменований сегмент спільної пам'яті (POSIX shm або іменоване відображення Windows)
+class SharedSegment {
+    char* base = nullptr;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+    const char* name = "Local\\laba5_catalog";
+#else
+    const char* name = "/laba5_catalog";
+#endif
+
+public:
+    SharedSegment() = default;
+    SharedSegment(const SharedSegment&) = delete;
+    SharedSegment& operator=(const SharedSegment&) = delete;
+
+    ~SharedSegment() {
+        close();
+    }
+
+    char* data() const {
+        return base;
+    }
+
+    size_t size() const {
+        return mappedSize;
+    }
+
+    static uint32_t currentPid() {
+#ifdef _WIN32
+        return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+        return static_cast<uint32_t>(getpid());
+#endif
+    }
+
+    static bool processAlive(uint32_t pid) {
+#ifdef _WIN32
+        HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+        if (!process) return GetLastError() == ERROR_ACCESS_DENIED;
+        bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+        CloseHandle(process);
+        return alive;
+#else
+        return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#endif
+    }
+
+    // Створює новий сегмент; false, якщо його вже створив інший процес
+    bool create(size_t bytes) {
+#ifdef _WIN32
+        uint64_t size64 = bytes;
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                     static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), name);
+        if (!mapping) throw runtime_error("Cannot create shared catalog");
+        if (GetLastError() == ERROR_ALREADY_EXISTS) {
+            close();
+            return false;
+        }
+        base = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes));
+        if (!base) {
+            close();
+            throw runtime_error("Cannot map shared catalog");
+        }
+#else
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) {
+            if (errno == EEXIST) return false;
+            throw runtime_error("Cannot create shared catalog");
+        }
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            shm_unlink(name);
+            throw runtime_error("Cannot resize shared catalog");
+        }
+        void* view = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) throw runtime_error("Cannot map shared catalog");
+        base = static_cast<char*>(view);
+#endif
+        mappedSize = bytes;
+        return true;
+    }
+
+    // Підключається до наявного сегмента; false, якщо його ще немає або він порожній
+    bool open() {
+#ifdef _WIN32
+        mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+        if (!mapping) return false;
+        base = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+        if (!base) {
+            close();
+            return false;
+        }
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(base, &info, sizeof(info));
+        mappedSize = info.RegionSize;
+#else
+        int fd = shm_open(name, O_RDWR, 0600);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SharedHeader)) {
+            ::close(fd);
+            return false;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) return false;
+        base = static_cast<char*>(view);
+        mappedSize = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    // Прибирає ім'я сегмента; пам'ять звільниться, коли його закриють усі процеси.
+    // У Windows іменоване відображення зникає само разом з останнім дескриптором
+    void unlink() {
+#ifndef _WIN32
+        shm_unlink(name);
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        if (base) munmap(base, mappedSize);
+#endif
+        base = nullptr;
+        mappedSize = 0;
+    }
+};
+
+// Каталог у спільній пам'яті: один процес будує, інші підключаються і читають записи
+// на місці, без копій у власній пам'яті. Поруч із записами лежать таблиці відкритої
+// адресації за ID та за автором, тож унікальність ID і лічильники спільні для всіх процесів.
+// Місткість фіксується при побудові (удвічі більше за каталог, не менше 1024 записів)
+// і не росте; сегмент перебудовується, коли від'єднається останній процес
+class SharedCatalog {
+public:
+    static const uint64_t noRecord = ~0ULL;
+
+private:
+    static const uint32_t segmentMagic = 0x3543424C; // "LBC5"
+    static const uint32_t segmentVersion = 6;
+    static const uint32_t stateEmpty = 0;
+    static const uint32_t stateBuilding = 1;
+    static const uint32_t stateReady = 2;
+    static const uint32_t stateClosing = 3;
+    static const size_t maxProcesses = 64;
+    static const int stallLimit = 40;  // ~2 с очікування, після чого сегмент вважається покинутим
+    static const size_t arenaPerRecord = 256;
+    static const uint32_t typeBook = 1;
+    static const uint32_t typeMagazine = 2;
+
+    SharedSegment segment;
+
+    SharedHeader* header() const {
+        return reinterpret_cast<SharedHeader*>(segment.data());
+    }
+
+    SharedRecord* record(uint64_t index) const {
+        return reinterpret_cast<SharedRecord*>(segment.data() + header()->recordsOffset) + index;
+    }
+
+    atomic<uint64_t>* idTable() const {
+        return reinterpret_cast<atomic<uint64_t>*>(segment.data() + header()->idTableOffset);
+    }
+
+    SharedAuthorSlot* authorTable() const {
+        return reinterpret_cast<SharedAuthorSlot*>(segment.data() + header()->authorTableOffset);
+    }
+
+    // Слот читача: зсув його останнього рядка в readers.dat + 1, 0 - читача немає
+    atomic<uint64_t>* readerTable() const {
+        return reinterpret_cast<atomic<uint64_t>*>(segment.data() + header()->readerTableOffset);
+    }
+
+    static size_t headerBytes() {
+        return (sizeof(SharedHeader) + 63) / 64 * 64;
+    }
+
+    // Так само рахується й місткість таблиці читачів за кількістю наявних ID
+    static size_t capacityFor(size_t items) {
+        return max<size_t>(items * 2, 1024);
+    }
+
+    // Таблиці ID та авторів мають удвічі більше слотів, ніж записів
+    static size_t bytesFor(size_t capacity, size_t readerCapacity) {
+        return headerBytes() + capacity * (sizeof(SharedRecord) + arenaPerRecord) +
+               capacity * 2 * (sizeof(atomic<uint64_t>) + sizeof(SharedAuthorSlot)) +
+               readerCapacity * sizeof(atomic<uint64_t>);
+    }
+
+    // FNV-1a
+    static uint64_t hashOf(const char* data, size_t length) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    const char* text(const SharedString& s) const {
+        return segment.data() + s.offset;
+    }
+
+    bool sameText(const SharedString& s, const char* data, size_t length) const {
+        return s.length == length && memcmp(text(s), data, length) == 0;
+    }
+
+    string readString(const SharedString& s) const {
+        return string(text(s), s.length);
+    }
+
+    SharedString writeString(const string& value, uint64_t& offset) {
+        memcpy(segment.data() + offset, value.data(), value.size());
+        SharedString s = { offset, static_cast<uint32_t>(value.size()), 0 };
+        offset += value.size();
+        return s;
+    }
+
+    // Займає ID запису в таблиці; false, якщо такий ID уже є. Вільний слот захоплюється
+    // через CAS, тож з двох процесів, що додають однаковий ID, виграє лише один
+    bool claimId(uint64_t index) {
+        const SharedString& id = record(index)->id;
+        uint64_t size = header()->tableSize;
+        uint64_t slot = hashOf(text(id), id.length) % size;
+        for (uint64_t probe = 0; probe < size; ++probe) {
+            atomic<uint64_t>& entry = idTable()[slot];
+            uint64_t current = entry.load(memory_order_acquire);
+            if (current == 0 && entry.compare_exchange_strong(current, index + 1)) return true;
+            // Після невдалого CAS current містить запис, що зайняв слот першим
+            if (sameText(record(current - 1)->id, text(id), id.length)) return false;
+            slot = (slot + 1) % size;
+        }
+        throw runtime_error("Shared catalog is full; restart all --shared sessions to enlarge it");
+    }
+
+    void countAuthor(uint64_t index) {
+        const SharedString& author = record(index)->author;
+        uint64_t size = header()->tableSize;
+        uint64_t slot = hashOf(text(author), author.length) % size;
+        for (uint64_t probe = 0; probe < size; ++probe) {
+            SharedAuthorSlot& entry = authorTable()[slot];
+            uint64_t current = entry.record.load(memory_order_acquire);
+            if (current == 0 && entry.record.compare_exchange_strong(current, index + 1)) {
+                header()->authorCount.fetch_add(1);
+                entry.count.fetch_add(1);
+                return;
+            }
+            if (sameText(record(current - 1)->author, text(author), author.length)) {
+                entry.count.fetch_add(1);
+                return;
+            }
+            slot = (slot + 1) % size;
+        }
+    }
+
+    // Займає вільний слот або слот завершеного процесу
+    bool attach(uint32_t self) {
+        SharedHeader* h = header();
+        for (size_t i = 0; i < maxProcesses; ++i) {
+            uint32_t pid = h->attached[i].load();
+            if ((pid == 0 || !SharedSegment::processAlive(pid)) &&
+                h->attached[i].compare_exchange_strong(pid, self)) return true;
+        }
+        return false;
+    }
+
+    void detach(uint32_t self) {
+        SharedHeader* h = header();
+        for (size_t i = 0; i < maxProcesses; ++i) {
+            uint32_t pid = self;
+            h->attached[i].compare_exchange_strong(pid, 0);
+        }
+    }
+
+    // Чи підключений ще хтось, крім self; слоти завершених процесів звільняються
+    bool othersAttached(uint32_t self) {
+        SharedHeader* h = header();
+        bool found = false;
+        for (size_t i = 0; i < maxProcesses; ++i) {
+            uint32_t pid = h->attached[i].load();
+            if (pid == 0 || pid == self) continue;
+            if (SharedSegment::processAlive(pid)) found = true;
+            else h->attached[i].compare_exchange_strong(pid, 0);
+        }
+        return found;
+    }
+
+    static bool stampOf(const FileManager& files, uint64_t& size, int64_t& modified) {
+        size = 0;
+        modified = 0;
+        return files.itemsStamp(size, modified);
+    }
+
+    bool matchesFile(const FileManager& files) const {
+        uint64_t size;
+        int64_t modified;
+        stampOf(files, size, modified);
+        return header()->fileSize == size && header()->fileModified == modified;
+    }
+
+    // Прибирає покинутий сегмент, щоб наступна спроба створила новий
+    void discard() {
+        segment.unlink();
+        segment.close();
+    }
+
+    // Розмітка нового сегмента та заповнення з файлів; викликає лише творець.
+    // readerEntries[id] - зсув останнього запису читача + 1.
+    // Щойно створений сегмент заповнений нулями, тож записи й таблиці не очищаються
+    void build(const vector<shared_ptr<LibraryItem>>& catalog, const vector<uint64_t>& readerEntries,
+               const FileManager& files) {
+        size_t capacity = capacityFor(catalog.size());
+        SharedHeader* h = header();
+        h->magic = segmentMagic;
+        h->version = segmentVersion;
+        h->capacity = capacity;
+        h->tableSize = capacity * 2;
+        h->recordsOffset = headerBytes();
+        h->idTableOffset = h->recordsOffset + capacity * sizeof(SharedRecord);
+        h->authorTableOffset = h->idTableOffset + h->tableSize * sizeof(atomic<uint64_t>);
+        h->readerTableOffset = h->authorTableOffset + h->tableSize * sizeof(SharedAuthorSlot);
+        h->readerCapacity = capacityFor(readerEntries.size());
+        h->arenaOffset = h->readerTableOffset + h->readerCapacity * sizeof(atomic<uint64_t>);
+        h->arenaSize = capacity * arenaPerRecord;
+        stampOf(files, h->fileSize, h->fileModified);
+
+        uint64_t readers = 0;
+        for (size_t id = 1; id < readerEntries.size(); ++id) {
+            if (readerEntries[id] == 0) continue;
+            readerTable()[id].store(readerEntries[id]);
+            ++readers;
+        }
+        h->readerCount.store(readers);
+        h->nextReaderId.store(max<uint64_t>(readerEntries.size(), 1));
+
+        for (const auto& item : catalog) {
+            if (append(*item) == noRecord) cerr << "Duplicate ID skipped: " << item->getId() << endl;
+        }
+        h->dirty.store(0);
+        h->state.store(stateReady, memory_order_release);
+    }
+
+public:
+    static size_t segmentBytes(size_t items, size_t readerIds) {
+        return bytesFor(capacityFor(items), capacityFor(readerIds));
+    }
+
+    // Підключається до сегмента або будує новий. Аварійно покинутий сегмент прибирається
+    // і створюється заново, а сегмент від старого library_items.dat - якщо ним більше
+    // ніхто не користується
+    void open(FileManager& files) {
+        uint32_t self = SharedSegment::currentPid();
+        vector<shared_ptr<LibraryItem>> catalog;
+        vector<uint64_t> readerEntries;
+        bool loaded = false;
+        int stalled = 0;
+        for (int attempt = 0; attempt < 200; ++attempt) {
+            if (!segment.data() && !segment.open()) {
+                if (!loaded) {
+                    catalog = files.loadItems();
+                    files.scanReaders([&readerEntries](uint64_t id, uint64_t offset) {
+                        // Пошкоджений ID не повинен роздувати таблицю
+                        if (id == 0 || id > 0xFFFFFFFFULL) return;
+                        if (id >= readerEntries.size()) readerEntries.resize(static_cast<size_t>(id) + 1);
+                        readerEntries[static_cast<size_t>(id)] = offset + 1;
+                    });
+                    loaded = true;
+                }
+                if (segment.create(segmentBytes(catalog.size(), readerEntries.size()))) {
+                    header()->ownerPid.store(self);
+                    header()->state.store(stateBuilding);
+                    attach(self);
+                    build(catalog, readerEntries, files);
+                    return;
+                }
+                // Сегмент є, але порожній: творець міг завершитися до ftruncate
+                if (++stalled > stallLimit) {
+                    segment.unlink();
+                    stalled = 0;
+                }
+                this_thread::sleep_for(chrono::milliseconds(50));
+                continue;
+            }
+
+            SharedHeader* h = header();
+            uint32_t state = h->state.load(memory_order_acquire);
+            if (state == stateReady && (h->magic != segmentMagic || h->version != segmentVersion)) {
+                discard();
+                continue;
+            }
+            if (state == stateReady) {
+                if (!attach(self)) throw runtime_error("Too many processes use the shared catalog");
+                // Останній процес міг саме закрити сегмент між перевіркою і підключенням
+                if (h->state.load(memory_order_acquire) != stateReady) {
+                    detach(self);
+                    segment.close();
+                    this_thread::sleep_for(chrono::milliseconds(50));
+                    continue;
+                }
+                if (matchesFile(files)) return;
+                if (othersAttached(self)) {
+                    cerr << "library_items.dat changed while shared sessions are running; "
+                            "the running shared catalog is used instead\n";
+                    return;
+                }
+                uint32_t expected = stateReady;
+                if (h->state.compare_exchange_strong(expected, stateClosing)) {
+                    if (othersAttached(self)) {
+                        h->state.store(stateReady);
+                        return;
+                    }
+                    detach(self);
+                    discard();
+                    continue;
+                }
+                detach(self);
+                segment.close();
+                continue;
+            }
+
+            // Будівник або процес, що закривав сегмент, завершився аварійно. Таблиці
+            // могли лишитися напівзаповненими, тож сегмент не добудовується, а створюється заново
+            uint32_t owner = h->ownerPid.load();
+            bool abandoned = owner != 0 && !SharedSegment::processAlive(owner);
+            if (abandoned && h->ownerPid.compare_exchange_strong(owner, self)) {
+                h->state.store(stateClosing);
+                discard();
+                stalled = 0;
+                continue;
+            }
+            // Творець не встиг записати свій PID
+            if (owner == 0 && ++stalled > stallLimit) {
+                discard();
+                stalled = 0;
+                continue;
+            }
+            // Сегмент закривається: після shm_unlink наступна спроба створить новий
+            if (state == stateClosing) segment.close();
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+        throw runtime_error("Shared catalog is not ready");
+    }
+
+    // Від'єднання: true, якщо процес був останнім і сегмент переведено в закриття.
+    // Тоді викликач ще може прочитати сегмент і має завершити його через finishClose
+    bool beginClose() {
+        if (!segment.data()) return false;
+        uint32_t self = SharedSegment::currentPid();
+        SharedHeader* h = header();
+        detach(self);
+        if (othersAttached(self)) {
+            segment.close();
+            return false;
+        }
+        uint32_t expected = stateReady;
+        if (!h->state.compare_exchange_strong(expected, stateClosing)) {
+            segment.close();
+            return false;
+        }
+        if (othersAttached(self)) {
+            h->state.store(stateReady);
+            segment.close();
+            return false;
+        }
+        h->ownerPid.store(self);
+        return true;
+    }
+
+    void finishClose() {
+        discard();
+    }
+
+    bool isDirty() const {
+        return header()->dirty.load() != 0;
+    }
+
+    uint64_t takeReaderId() {
+        uint64_t id = header()->nextReaderId.fetch_add(1);
+        if (id >= header()->readerCapacity) {
+            throw runtime_error("Reader table is full; restart all --shared sessions to enlarge it");
+        }
+        return id;
+    }
+
+    // Межа виданих ID: усі читачі мають ID, менші за неї
+    uint64_t nextReaderId() const {
+        return min<uint64_t>(header()->nextReaderId.load(), header()->readerCapacity);
+    }
+
+    // Зсув останнього запису читача в readers.dat + 1; 0 - такого читача немає
+    uint64_t readerEntry(uint64_t id) const {
+        if (id == 0 || id >= header()->readerCapacity) return 0;
+        return readerTable()[id].load(memory_order_acquire);
+    }
+
+    // Переводить читача на новий запис, якщо його ніхто не змінив після читання seen
+    bool publishReader(uint64_t id, uint64_t seen, uint64_t offset) {
+        if (id == 0 || id >= header()->readerCapacity) return false;
+        if (!readerTable()[id].compare_exchange_strong(seen, offset + 1)) return false;
+        if (seen == 0) header()->readerCount.fetch_add(1);
+        return true;
+    }
+
+    size_t readerCount() const {
+        return static_cast<size_t>(header()->readerCount.load());
+    }
+
+    uint64_t recordCount() const {
+        return min<uint64_t>(header()->recordCount.load(memory_order_acquire), header()->capacity);
+    }
+
+    // 0 - запис ще пишеться, 1 - готовий, 2 - слот зіпсований або ID зайнятий; такі пропускаються
+    uint32_t recordState(uint64_t index) const {
+        return record(index)->published.load(memory_order_acquire);
+    }
+
+    // Номер запису з таким ID або noRecord; запис може бути ще не опублікований
+    uint64_t find(const string& id) const {
+        uint64_t size = header()->tableSize;
+        uint64_t slot = hashOf(id.data(), id.size()) % size;
+        for (uint64_t probe = 0; probe < size; ++probe) {
+            uint64_t current = idTable()[slot].load(memory_order_acquire);
+            if (current == 0) return noRecord;
+            if (sameText(record(current - 1)->id, id.data(), id.size())) return current - 1;
+            slot = (slot + 1) % size;
+        }
+        return noRecord;
+    }
+
+    // Окрема копія одного запису, наприклад для позик читача
+    shared_ptr<LibraryItem> makeItem(uint64_t index) const {
+        const SharedRecord* r = record(index);
+        if (r->type == typeBook) {
+            return make_shared<Book>(readString(r->title), readString(r->author), readString(r->id),
+                                     readString(r->isbn), r->borrowed.load() != 0);
+        }
+        return make_shared<Magazine>(readString(r->title), readString(r->author), readString(r->id), r->issue);
+    }
+
+    // Копія всього каталогу; потрібна лише останньому процесу для запису файлу
+    vector<shared_ptr<LibraryItem>> loadAll() const {
+        vector<shared_ptr<LibraryItem>> all;
+        uint64_t count = recordCount();
+        all.reserve(static_cast<size_t>(count));
+        for (uint64_t index = 0; index < count; ++index) {
+            if (recordState(index) == 1) all.push_back(makeItem(index));
+        }
+        return all;
+    }
+
+    void readFields(uint64_t index, ViewFields& fields) const {
+        const SharedRecord* r = record(index);
+        fields.title.assign(text(r->title), r->title.length);
+        fields.author.assign(text(r->author), r->author.length);
+        fields.id.assign(text(r->id), r->id.length);
+    }
+
+    // Вивід запису прямо з сегмента у форматі Book::display / Magazine::display
+    void display(uint64_t index, ostream& out) const {
+        const SharedRecord* r = record(index);
+        out << "Title: ";
+        out.write(text(r->title), r->title.length);
+        out << ", Author: ";
+        out.write(text(r->author), r->author.length);
+        out << ", ID: ";
+        out.write(text(r->id), r->id.length);
+        if (r->type == typeBook) {
+            out << ", ISBN: ";
+            out.write(text(r->isbn), r->isbn.length);
+            out << ", Status: " << (r->borrowed.load() ? "Borrowed" : "Available") << endl;
+        } else {
+            out << ", Issue: " << r->issue << endl;
+        }
+    }
+
+    // Резервує слот і місце під рядки атомарно, тому писати можуть кілька процесів одразу.
+    // Повертає номер запису або noRecord, якщо такий ID уже є в каталозі
+    uint64_t append(const LibraryItem& item) {
+        SharedHeader* h = header();
+        const Book* book = dynamic_cast<const Book*>(&item);
+        const Magazine* magazine = dynamic_cast<const Magazine*>(&item);
+        string isbn = book ? book->getISBN() : "";
+        size_t bytes = item.getTitle().size() + item.getAuthor().size() + item.getId().size() + isbn.size();
+
+        uint64_t index = h->recordCount.fetch_add(1);
+        if (index >= h->capacity) {
+            throw runtime_error("Shared catalog is full; restart all --shared sessions to enlarge it");
+        }
+        SharedRecord* r = record(index);
+        uint64_t used = h->arenaUsed.fetch_add(bytes);
+        if (used + bytes > h->arenaSize) {
+            // Слот уже зайнятий, тож його треба позначити, інакше всі чекатимуть на нього вічно
+            r->published.store(2, memory_order_release);
+            throw runtime_error("Shared catalog is full; restart all --shared sessions to enlarge it");
+        }
+
+        uint64_t offset = h->arenaOffset + used;
+        bool borrowed = book && book->getBorrowedStatus();
+        r->type = book ? typeBook : typeMagazine;
+        r->issue = magazine ? magazine->getIssue() : 0;
+        r->title = writeString(item.getTitle(), offset);
+        r->author = writeString(item.getAuthor(), offset);
+        r->id = writeString(item.getId(), offset);
+        r->isbn = writeString(isbn, offset);
+        r->borrowed.store(borrowed ? 1 : 0);
+        if (!claimId(index)) {
+            r->published.store(2, memory_order_release);
+            return noRecord;
+        }
+        countAuthor(index);
+        if (book) h->bookCount.fetch_add(1);
+        else h->magazineCount.fetch_add(1);
+        if (borrowed) h->borrowedCount.fetch_add(1);
+        r->published.store(1, memory_order_release);
+        h->dirty.store(1);
+        return index;
+    }
+
+    // Атомарно позичає книгу; false, якщо її вже взяв хтось інший
+    bool tryBorrow(uint64_t index) {
+        uint32_t expected = 0;
+        if (!record(index)->borrowed.compare_exchange_strong(expected, 1)) return false;
+        header()->borrowedCount.fetch_add(1);
+        header()->dirty.store(1);
+        return true;
+    }
+
+    void release(uint64_t index) {
+        if (record(index)->borrowed.exchange(0) != 0) {
+            header()->borrowedCount.fetch_sub(1);
+            header()->dirty.store(1);
+        }
+    }
+
+    // Підсумки каталогу з лічильників сегмента - O(1)
+    void loadTotals(CatalogStats& stats) const {
+        const SharedHeader* h = header();
+        stats.setCatalogTotals(static_cast<size_t>(h->bookCount.load()), static_cast<size_t>(h->magazineCount.load()),
+                               static_cast<size_t>(h->borrowedCount.load()), static_cast<size_t>(h->authorCount.load()));
+    }
+
+    size_t itemsByAuthor(const string& author) const {
+        uint64_t size = header()->tableSize;
+        uint64_t slot = hashOf(author.data(), author.size()) % size;
+        for (uint64_t probe = 0; probe < size; ++probe) {
+            const SharedAuthorSlot& entry = authorTable()[slot];
+            uint64_t current = entry.record.load(memory_order_acquire);
+            if (current == 0) return 0;
+            if (sameText(record(current - 1)->author, author.data(), author.size())) {
+                return static_cast<size_t>(entry.count.load());
+            }
+            slot = (slot + 1) % size;
+        }
+        return 0;
+    }
+
+    // Список за авторами прямо з таблиці сегмента
+    void displayAuthors(ostream& out) const {
+        uint64_t size = header()->tableSize;
+        for (uint64_t slot = 0; slot < size; ++slot) {
+            const SharedAuthorSlot& entry = authorTable()[slot];
+            uint64_t current = entry.record.load(memory_order_acquire);
+            if (current == 0) continue;
+            const SharedString& author = record(current - 1)->author;
+            out << "  ";
+            out.write(text(author), author.length);
+            out << ": " << entry.count.load() << endl;
+        }
+    }
+};
+
+// Операції, які записуються в трасу сесії
+enum class TraceOp : uint8_t {
+    Login = 1,
+    Register,
+    Logout,
+    AddBook,
+    AddMagazine,
+    List,
+    Borrow,
+    Return,
+    ViewHistory,
+    Browse
+};
+
+const char* traceOpName(TraceOp op) {
+    switch (op) {
+        case TraceOp::Login: return "login";
+        case TraceOp::Register: return "register";
+        case TraceOp::Logout: return "logout";
+        case TraceOp::AddBook: return "add-book";
+        case TraceOp::AddMagazine: return "add-magazine";
+        case TraceOp::List: return "list";
+        case TraceOp::Borrow: return "borrow";
+        case TraceOp::Return: return "return";
+        case TraceOp::ViewHistory: return "history";
+        case TraceOp::Browse: return "browse";
+    }
+    return "unknown";
+}
+
+struct TraceEvent {
+    TraceOp op;
+    uint64_t offsetMicros;  // час від початку запису
+    vector<string> texts;
+    vector<uint64_t> numbers;
+};
+
+// Стан системи на початку запису у форматах файлів каталогу, читачів і резервів
+struct TraceSnapshot {
+    string items;
+    string readers;
+    string holds;
+};
+
+// Двійковий формат: заголовок зі знімком стану, далі код операції, дельта часу
+// і аргументи у вигляді varint
+class TraceWriter {
+    static const uint32_t fileMagic = 0x3252544C; // "LTR2"
+    static const uint32_t oldMagic = 0x3152544C;  // "LTR1", без знімка
+
+    ofstream file;
+    chrono::steady_clock::time_point start;
+    uint64_t lastOffset = 0;
+    mutex guard;
+
+    void writeVarint(uint64_t value) {
+        while (value >= 0x80) {
+            file.put(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        file.put(static_cast<char>(value));
+    }
+
+public:
+    TraceWriter(const string& path, const TraceSnapshot& snapshot)
+        : file(path, ios::binary), start(chrono::steady_clock::now()) {
+        if (!file.is_open()) throw runtime_error("Cannot open file: " + path);
+        uint32_t magic = fileMagic;
+        file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        for (const string* blob : { &snapshot.items, &snapshot.readers, &snapshot.holds }) {
+            writeVarint(blob->size());
+            file.write(blob->data(), blob->size());
+        }
+    }
+
+    void record(TraceOp op, const vector<string>& texts = {}, const vector<uint64_t>& numbers = {}) {
+        lock_guard<mutex> lock(guard);
+        uint64_t offset = static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(
+            chrono::steady_clock::now() - start).count());
+        file.put(static_cast<char>(op));
+        writeVarint(offset - lastOffset);
+        lastOffset = offset;
+        writeVarint(texts.size());
+        for (const string& text : texts) {
+            writeVarint(text.size());
+            file.write(text.data(), text.size());
+        }
+        writeVarint(numbers.size());
+        for (uint64_t number : numbers) {
+            writeVarint(number);
+        }
+    }
+
+    static vector<TraceEvent> load(const string& path, TraceSnapshot& snapshot) {
+        ifstream in(path, ios::binary);
+        if (!in.is_open()) throw runtime_error("Cannot open file: " + path);
+        uint32_t magic = 0;
+        in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        if (in && magic == oldMagic) throw runtime_error("Trace file has no state snapshot, record it again: " + path);
+        if (!in || magic != fileMagic) throw runtime_error("Invalid trace file: " + path);
+
+        auto readVarint = [&in]() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                int c = in.get();
+                if (c == EOF) throw runtime_error("Truncated trace file");
+                value |= static_cast<uint64_t>(c & 0x7F) << shift;
+                if (!(c & 0x80)) break;
+            }
+            return value;
+        };
+
+        for (string* blob : { &snapshot.items, &snapshot.readers, &snapshot.holds }) {
+            blob->resize(static_cast<size_t>(readVarint()));
+            if (!blob->empty()) in.read(&(*blob)[0], blob->size());
+            if (!in) throw runtime_error("Truncated trace file");
+        }
+
+        vector<TraceEvent> events;
+        uint64_t offset = 0;
+        int op;
+        while ((op = in.get()) != EOF) {
+            TraceEvent event;
+            event.op = static_cast<TraceOp>(op);
+            offset += readVarint();
+            event.offsetMicros = offset;
+            event.texts.resize(static_cast<size_t>(readVarint()));
+            for (string& text : event.texts) {
+                text.resize(static_cast<size_t>(readVarint()));
+                in.read(&text[0], text.size());
+            }
+            event.numbers.resize(static_cast<size_t>(readVarint()));
+            for (uint64_t& number : event.numbers) {
+                number = readVarint();
+            }
+            if (!in) throw runtime_error("Truncated trace file");
+            events.push_back(event);
+        }
+        return events;
+    }
+};
+
+// Затримки операцій під час відтворення, у мікросекундах
+class LatencyReport {
+    map<string, vector<double>> samples;
+    map<string, size_t> failures;  // невдалі операції рахуються окремо й не входять у перцентилі
+
+public:
+    void add(TraceOp op, double micros) {
+        samples[traceOpName(op)].push_back(micros);
+    }
+
+    void addFailure(TraceOp op) {
+        ++failures[traceOpName(op)];
+    }
+
+    void merge(const LatencyReport& other) {
+        for (const auto& entry : other.samples) {
+            vector<double>& target = samples[entry.first];
+            target.insert(target.end(), entry.second.begin(), entry.second.end());
+        }
+        for (const auto& entry : other.failures) {
+            failures[entry.first] += entry.second;
+        }
+    }
+
+    void display() {
+        cout << "\n=== Replay Latency (us) ===\n";
+        for (auto& entry : samples) {
+            vector<double>& values = entry.second;
+            sort(values.begin(), values.end());
+            auto percentile = [&values](double p) {
+                size_t rank = static_cast<size_t>(ceil(p * values.size()));
+                return values[rank == 0 ? 0 : rank - 1];
+            };
+            cout << entry.first << ": count " << values.size()
+                 << ", p50 " << percentile(0.50) << ", p90 " << percentile(0.90)
+                 << ", p99 " << percentile(0.99) << ", max " << values.back() << endl;
+        }
+        size_t failed = 0;
+        for (const auto& entry : failures) {
+            cout << entry.first << ": failed " << entry.second << endl;
+            failed += entry.second;
+        }
+        cout << "Failed operations: " << failed << " (not included in latencies)" << endl;
+    }
+};
+
+// Потік виводу, що відкидає все записане
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override {
+        return c;
+    }
+};
+
+// Основна система
+class LibrarySystem {
+    vector<shared_ptr<LibraryItem>> items;
+    IdFilter idFilter;
+    IdIndex idIndex;
+    HoldManager holds;
+    CatalogStats stats;
+    CatalogViews views;
+    ReaderRegistry readers;
+    FileManager fileManager;
+    // У спільному режимі items порожній: номер елемента - це номер запису в сегменті
+    unique_ptr<SharedCatalog> shared;
+    bool viewsBuilt = false;          // спільні подання будуються лише при першому перегляді
+    uint64_t viewsScanned = 0;
+    vector<uint64_t> pendingViews;    // записи, які інший процес ще не дописав
+    unique_ptr<TraceWriter> trace;
+    bool persistent;
+    NullBuffer quietBuffer;
+    ostream out;  // власний потік екземпляра, щоб паралельні відтворення не ділили cout
+    User currentUser;
+    const string adminPassword = "admin123";
+    static const size_t browsePageSize = 10;
+    // Поки конструктор не завершився, індекси будуються одним проходом, а не вставками
+    bool indexesReady = false;
+
+    void rebuildIdFilter() {
+        idFilter.reset(items.size() * 2);
+        for (const auto& item : items) {
+            idFilter.add(item->getId());
+        }
+    }
+
+    void registerId(const string& id) {
+        idFilter.add(id);
+        if (idFilter.needsGrow()) rebuildIdFilter();
+    }
+
+    // Точна перевірка за індексом виконується лише тоді, коли фільтр не відкидає ID
+    bool idExists(const string& id) const {
+        if (shared) return shared->find(id) != SharedCatalog::noRecord;
+        if (!idFilter.mayContain(id)) return false;
+        return idIndex.contains(items, id);
+    }
+
+    void adoptItem(shared_ptr<LibraryItem> item) {
+        items.push_back(item);
+        if (indexesReady) {
+            views.insert({ item->getTitle(), item->getAuthor(), item->getId() }, static_cast<uint32_t>(items.size() - 1));
+            idIndex.insert(items, static_cast<uint32_t>(items.size() - 1));
+            registerId(item->getId());
+        }
+        stats.onItemAdded(*item);
+    }
+
+    // У спільному режимі ID займається атомарно в сегменті, тож false означає,
+    // що такий самий ID щойно додав інший процес
+    bool addItem(shared_ptr<LibraryItem> item) {
+        if (shared) return shared->append(*item) != SharedCatalog::noRecord;
+        adoptItem(item);
+        return true;
+    }
+
+    size_t catalogSize() const {
+        return shared ? static_cast<size_t>(shared->recordCount()) : items.size();
+    }
+
+    // Спільні слоти, які ще пишуться або зіпсовані, не показуються
+    bool isListed(size_t handle) const {
+        return !shared || shared->recordState(handle) == 1;
+    }
+
+    // Елемент за номером; у спільному режимі - копія одного запису з поточним станом
+    shared_ptr<LibraryItem> itemAt(size_t handle) const {
+        if (handle >= catalogSize() || !isListed(handle)) throw out_of_range("Invalid item number");
+        return shared ? shared->makeItem(handle) : items[handle];
+    }
+
+    shared_ptr<LibraryItem> itemById(const string& id) const {
+        if (shared) {
+            uint64_t index = shared->find(id);
+            if (index == SharedCatalog::noRecord || shared->recordState(index) != 1) return nullptr;
+            return shared->makeItem(index);
+        }
+        uint32_t handle;
+        return idIndex.find(items, id, handle) ? items[handle] : nullptr;
+    }
+
+    // Спільні подання будуються з полів сегмента при першому перегляді,
+    // далі до них дописуються лише нові записи
+    void syncViews() {
+        if (!shared) return;
+        uint64_t count = shared->recordCount();
+        if (!viewsBuilt) {
+            views.build(static_cast<size_t>(count), [this](size_t index, ViewFields& fields) {
+                if (shared->recordState(index) != 1) return false;
+                shared->readFields(index, fields);
+                return true;
+            });
+            for (uint64_t index = 0; index < count; ++index) {
+                if (shared->recordState(index) == 0) pendingViews.push_back(index);
+            }
+            viewsScanned = count;
+            viewsBuilt = true;
+            return;
+        }
+        for (uint64_t index = viewsScanned; index < count; ++index) {
+            pendingViews.push_back(index);
+        }
+        viewsScanned = count;
+
+        vector<uint64_t> stillPending;
+        ViewFields fields;
+        for (uint64_t index : pendingViews) {
+            uint32_t state = shared->recordState(index);
+            if (state == 2) continue;
+            if (state == 0) {
+                stillPending.push_back(index);
+                continue;
+            }
+            shared->readFields(index, fields);
+            views.insert(fields, static_cast<uint32_t>(index));
+        }
+        pendingViews.swap(stillPending);
+    }
+
+    // Завершення завантаження каталогу в пам'ять процесу: індекс ID, подання, прострочені резерви
+    void buildIndexes() {
+        idIndex.build(items);
+        views.build(items.size(), [this](size_t i, ViewFields& fields) {
+            fields.title = items[i]->getTitle();
+            fields.author = items[i]->getAuthor();
+            fields.id = items[i]->getId();
+            return true;
+        });
+        holds.expire(time(nullptr));
+        indexesReady = true;
+    }
+
+    void lendItem(size_t handle, const shared_ptr<LibraryItem>& item) {
+        uint64_t readerId = currentUser.getReaderId();
+        if (shared) {
+            // Спільний прапорець захоплюється атомарно, а якщо запис читача не вдалося
+            // оновити, книга звільняється знову
+            bool book = dynamic_pointer_cast<Book>(item) != nullptr;
+            if (book && !shared->tryBorrow(handle)) throw runtime_error("Book already borrowed!");
+            try {
+                updateSharedReader(readerId, [&item](ReaderRecord& record) { record.loans.push_back(item->getId()); });
+            } catch (...) {
+                if (book) shared->release(handle);
+                throw;
+            }
+            currentUser.borrowItem(item);
+        } else {
+            currentUser.borrowItem(item);
+            readers.addLoan(readerId, item->getId());
+        }
+        out << "Item borrowed successfully!\n";
+        stats.onBorrow(*item, readerId);
+    }
+
+    // Резерви прив'язані до ID читача, бо імена можуть повторюватися
+    string patronKey() const {
+        return to_string(currentUser.getReaderId());
+    }
+
+    // Останній запис читача в спільному режимі: зсув береться з сегмента, тож це один
+    // пошук у таблиці й одне читання рядка readers.dat незалежно від кількості читачів
+    bool readSharedReader(uint64_t id, uint64_t& entry, ReaderRecord& record) const {
+        entry = shared->readerEntry(id);
+        return entry != 0 && fileManager.readReaderAt(entry - 1, id, record);
+    }
+
+    // Позики змінюються так: запис читача перечитується, змінюється і дописується
+    // в журнал, а зсув у сегменті замінюється через CAS. Якщо інший процес устиг
+    // змінити того ж читача, спроба повторюється вже з його запису
+    template <typename Change>
+    void updateSharedReader(uint64_t id, Change change) {
+        while (true) {
+            uint64_t entry;
+            ReaderRecord record;
+            if (!readSharedReader(id, entry, record)) throw runtime_error("Unknown reader ID");
+            change(record);
+            uint64_t offset = fileManager.appendReader(ReaderRegistry::formatLine(id, record));
+            if (shared->publishReader(id, entry, offset)) return;
+        }
+    }
+
+    void setCurrentUser(uint64_t id, const ReaderRecord& record) {
+        currentUser = User(record.name, id);
+        for (const string& loan : record.loans) {
+            shared_ptr<LibraryItem> item = itemById(loan);
+            if (item) currentUser.restoreItem(item);
+        }
+    }
+
+    // У спільному режимі позики читача могли змінитися в іншому процесі
+    void refreshCurrentUser() {
+        uint64_t id = currentUser.getReaderId();
+        if (!shared || id == 0) return;
+        uint64_t entry;
+        ReaderRecord record;
+        if (!readSharedReader(id, entry, record)) throw runtime_error("Unknown reader ID");
+        setCurrentUser(id, record);
+    }
+
+    bool reservedForOther(const Book& book) const {
+        string patron = holds.reservedFor(book.getId());
+        return !patron.empty() && patron != patronKey();
+    }
+
+    void login() {
+        uint64_t id = static_cast<uint64_t>(getIntInput("Enter reader ID (0 to register): "));
+        if (id == 0) {
+            string name;
+            while (true) {
+                out << "Enter your name: ";
+                getline(cin, name);
+                // '|' розділяє поля в readers.dat
+                if (!name.empty() && name.find('|') == string::npos) break;
+                out << "Name cannot be empty or contain '|'.\n";
+            }
+            id = registerReader(name);
+            out << "Registered. Your reader ID: " << id << endl;
+        } else if (!loginAs(id)) {
+            out << "Unknown reader ID.\n";
+        }
+    }
+
+    void clearInput() {
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    }
+
+    int getIntInput(const string& prompt) {
+        int value;
+        while (true) {
+            out << prompt;
+            if (cin >> value) {
+                clearInput();
+                return value;
+            }
+            clearInput();
+            out << "Invalid input. Try again.\n";
+        }
+    }
+
+public:
+    // persistent = false: нічого не записується у файли; quiet = true: вивід відкидається (відтворення трас)
+    explicit LibrarySystem(bool sharedMode = false, bool persistent = true, bool quiet = false)
+        : persistent(persistent), out(quiet ? &quietBuffer : cout.rdbuf()) {
+        // Спільний каталог читається прямо з сегмента: ні копій записів, ні власних індексів.
+        // Читачі теж знаходяться через сегмент, а резерви в спільному режимі не підтримуються
+        if (sharedMode) {
+            shared.reset(new SharedCatalog());
+            shared->open(fileManager);
+            indexesReady = true;
+            return;
+        }
+
+        // Лічильники статистики набираються тими ж інкрементальними оновленнями, що й під час роботи
+        for (auto& item : fileManager.loadItems()) {
+            adoptItem(item);
+        }
+        // Збережений фільтр придатний лише для того самого файлу каталогу
+        uint64_t catalogSize = 0;
+        int64_t catalogModified = 0;
+        bool stamped = fileManager.itemsStamp(catalogSize, catalogModified);
+        if (!stamped || !fileManager.loadIdFilter(idFilter) || !idFilter.describes(catalogSize, catalogModified)) {
+            rebuildIdFilter();
+        }
+        fileManager.loadHolds(holds);
+        fileManager.loadReaders(readers);
+        buildIndexes();
+    }
+
+    // Відтворення траси: стан береться зі знімка в її заголовку, а не з поточних файлів,
+    // тож та сама траса щоразу виконується на тому самому каталозі
+    explicit LibrarySystem(const TraceSnapshot& snapshot)
+        : persistent(false), out(&quietBuffer) {
+        istringstream itemLines(snapshot.items), readerLines(snapshot.readers), holdLines(snapshot.holds);
+        for (auto& item : FileManager::readItems(itemLines)) {
+            adoptItem(item);
+        }
+        rebuildIdFilter();
+        FileManager::readHolds(holdLines, holds);
+        FileManager::readReaders(readerLines, readers);
+        buildIndexes();
+    }
+
+    ~LibrarySystem() {
+        if (shared) {
+            closeShared();
+            return;
+        }
+        if (!persistent) return;
+        fileManager.saveItems(items);
+        // Відбиток знімається вже із записаного файлу
+        uint64_t catalogSize = 0;
+        int64_t catalogModified = 0;
+        if (fileManager.itemsStamp(catalogSize, catalogModified)) {
+            idFilter.stamp(catalogSize, catalogModified);
+            fileManager.saveIdFilter(idFilter);
+        }
+        fileManager.saveHolds(holds);
+        fileManager.saveReaders(readers);
+    }
+
+    // Файли спільного каталогу записує лише останній процес: каталог копіюється з сегмента
+    // один раз, фільтр не зберігається, а журнал читачів стискається у знімок
+    void closeShared() {
+        bool last = shared->beginClose();
+        if (!last) return;
+        try {
+            if (shared->isDirty()) fileManager.saveItems(shared->loadAll());
+            if (persistent) {
+                const SharedCatalog& catalog = *shared;
+                fileManager.compactReaders(catalog.nextReaderId(), [&catalog](uint64_t id) { return catalog.readerEntry(id); });
+            }
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << endl;
+        }
+        shared->finishClose();
+    }
+
+    // Траса починається зі знімка поточного стану. У спільному режимі каталог і читачів
+    // паралельно змінюють інші процеси, тож траса не відтворювалася б - запис заборонено
+    void startTrace(const string& path) {
+        if (shared) throw invalid_argument("--trace cannot be used with --shared: other processes change the catalog");
+        TraceSnapshot snapshot;
+        ostringstream itemLines, readerLines, holdLines;
+        FileManager::writeItems(itemLines, items);
+        readers.saveToFile(readerLines);
+        holds.saveToFile(holdLines);
+        snapshot.items = itemLines.str();
+        snapshot.readers = readerLines.str();
+        snapshot.holds = holdLines.str();
+        trace.reset(new TraceWriter(path, snapshot));
+    }
+
+    void record(TraceOp op, const vector<string>& texts = {}, const vector<uint64_t>& numbers = {}) {
+        if (trace) trace->record(op, texts, numbers);
+    }
+
+    // Виконання однієї операції з траси без діалогу з користувачем;
+    // операція, що не вдалася, повідомляється винятком
+    void apply(const TraceEvent& event) {
+        auto number = [&event](size_t i) { return event.numbers.at(i); };
+        auto text = [&event](size_t i) -> const string& { return event.texts.at(i); };
+        switch (event.op) {
+            case TraceOp::Login:
+                if (!loginAs(number(0))) throw runtime_error("Unknown reader ID");
+                break;
+            case TraceOp::Register: registerReader(text(0)); break;
+            case TraceOp::Logout: logout(); break;
+            case TraceOp::AddBook:
+                if (!addBook(text(0), text(1), text(2), text(3))) throw runtime_error("ID already exists");
+                break;
+            case TraceOp::AddMagazine:
+                if (!addMagazine(text(0), text(1), text(2), static_cast<int>(number(0)))) {
+                    throw runtime_error("ID already exists");
+                }
+                break;
+            case TraceOp::List: listItems(); break;
+            case TraceOp::Borrow: borrowAt(static_cast<size_t>(number(0)), number(1) != 0); break;
+            case TraceOp::Return: returnAt(static_cast<size_t>(number(0))); break;
+            case TraceOp::ViewHistory: viewHistory(); break;
+            case TraceOp::Browse:
+                browsePage(static_cast<ViewOrder>(number(0)), static_cast<size_t>(number(1)));
+                break;
+            default: throw runtime_error("Unknown trace operation");
+        }
+    }
+
+    void run() {
+        while (true) {
+            out << "\n=== Library System ===\n";
+            out << "1. Login as Admin\n";
+            out << "2. Login as User\n";
+            out << "3. View User History\n";
+            out << "4. Exit\n";
+
+            int choice = getIntInput("Choose option: ");
+            try {
+                switch (choice) {
+                    case 1: adminMenu(); break;
+                    case 2: userMenu(); break;
+                    case 3: viewHistory(); break;
+                    case 4: return;
+                    default: out << "Invalid choice!\n";
+                }
+            } catch (const exception& e) {
+                cerr << "Error: " << e.what() << endl;
+            }
+        }
+    }
+
+    void adminMenu() {
+        out << "Enter admin password: ";
+        string pass;
+        getline(cin, pass);
+        if (pass != adminPassword) {
+            out << "Incorrect password.\n";
+            return;
+        }
+
+        while (true) {
+            out << "\n=== Admin Menu ===\n";
+            out << "1. Add Book\n";
+            out << "2. Add Magazine\n";
+            out << "3. List All Items\n";
+            out << "4. Statistics\n";
+            out << "5. Detailed Statistics\n";
+            out << "6. Items by Author\n";
+            out << "7. Verify Statistics\n";
+            out << "8. Browse Sorted\n";
+            out << "9. Back\n";
+
+            int choice = getIntInput("Choose option: ");
+            switch (choice) {
+                case 1: addBook(); break;
+                case 2: addMagazine(); break;
+                case 3: listItems(); break;
+                case 4: showStatistics(); break;
+                case 5: showDetailedStatistics(); break;
+                case 6: showAuthorCount(); break;
+                case 7: verifyStatistics(); break;
+                case 8: browseSorted(); break;
+                case 9: return;
+                default: out << "Invalid option.\n";
+            }
+        }
+    }
+
+    // Вхід за ID читача з відновленням його поточних позик
+    bool loginAs(uint64_t id) {
+        record(TraceOp::Login, {}, { id });
+        ReaderRecord entry;
+        if (shared) {
+            uint64_t offset;
+            if (!readSharedReader(id, offset, entry)) return false;
+        } else if (!readers.find(id, entry)) {
+            return false;
+        }
+
+        setCurrentUser(id, entry);
+        readers.beginSession();
+        return true;
+    }
+
+    uint64_t registerReader(const string& name) {
+        record(TraceOp::Register, { name });
+        uint64_t id;
+        if (shared) {
+            id = shared->takeReaderId();
+            ReaderRecord entry;
+            entry.name = name;
+            shared->publishReader(id, 0, fileManager.appendReader(ReaderRegistry::formatLine(id, entry)));
+        } else {
+            id = readers.registerReader(name);
+        }
+        currentUser = User(name, id);
+        readers.beginSession();
+        return id;
+    }
+
+    void logout() {
+        record(TraceOp::Logout);
+        readers.endSession();
+        if (persistent) fileManager.saveUserHistory(currentUser);
+        currentUser = User();
+    }
+
+    void userMenu() {
+        login();
+        if (currentUser.getReaderId() == 0) return;
+        const string name = currentUser.getName();
+
+        while (true) {
+            out << "\n=== User Menu (" << name << ") ===\n";
+            out << "1. Browse Items\n";
+            out << "2. Borrow Item\n";
+            out << "3. View My Borrowed Items\n";
+            out << "4. Return Item\n";
+            out << "5. Browse Sorted\n";
+            out << "6. Back to Main Menu\n";
+
+            int choice = getIntInput("Choose option: ");
+            // Помилка операції не повинна обривати сесію читача
+            try {
+                switch (choice) {
+                    case 1: listItems(); break;
+                    case 2: borrowItem(); break;
+                    case 3:
+                        refreshCurrentUser();
+                        currentUser.displayBorrowed(out);
+                        break;
+                    case 4: returnItem(); break;
+                    case 5: browseSorted(); break;
+                    case 6:
+                        logout();
+                        return;
+                    default: out << "Invalid option.\n";
+                }
+            } catch (const exception& e) {
+                cerr << "Error: " << e.what() << endl;
+            }
+        }
+    }
+
+    // O(1) і в спільному режимі: підсумки читаються з лічильників сегмента
+    void showStatistics() {
+        if (shared) shared->loadTotals(stats);
+        out << "\n=== Statistics ===\n";
+        stats.display(out);
+        out << "Registered readers: " << (shared ? shared->readerCount() : readers.size())
+            << ", Active sessions: " << readers.sessionCount() << endl;
+    }
+
+    void showDetailedStatistics() {
+        out << "\n=== Detailed Statistics ===\n";
+        if (!shared) {
+            stats.displayDetails(out);
+            return;
+        }
+        out << "Items per author:\n";
+        shared->displayAuthors(out);
+        stats.displayReaders(out);
+    }
+
+    // Запит за одним автором - один пошук у хеш-таблиці лічильників
+    void showAuthorCount() {
+        out << "Enter author: ";
+        string author;
+        getline(cin, author);
+        size_t count = shared ? shared->itemsByAuthor(author) : stats.authorCount(author);
+        out << "Items by " << author << ": " << count << endl;
+    }
+
+    // Перерахунок з нуля і порівняння з інкрементальними лічильниками;
+    // у спільному режимі - з лічильниками й таблицею авторів сегмента
+    bool verifyStatistics() {
+        CatalogStats recomputed;
+        bool consistent;
+        if (shared) {
+            uint64_t count = shared->recordCount();
+            for (uint64_t index = 0; index < count; ++index) {
+                if (shared->recordState(index) == 1) recomputed.onItemAdded(*shared->makeItem(index));
+            }
+            shared->loadTotals(stats);
+            const SharedCatalog& catalog = *shared;
+            consistent = stats.sameTotals(recomputed) &&
+                         recomputed.authorsMatch([&catalog](const string& author) { return catalog.itemsByAuthor(author); });
+        } else {
+            recomputed = CatalogStats::recompute(items);
+            consistent = stats.sameCatalogCounters(recomputed);
+        }
+        if (consistent) {
+            out << "Statistics are consistent.\n";
+            return true;
+        }
+        out << "Statistics mismatch! Recomputed values:\n";
+        recomputed.display(out);
+        return false;
+    }
+
+    void viewHistory() {
+        record(TraceOp::ViewHistory);
+        auto history = fileManager.loadUserHistory();
+        if (history.empty()) {
+            out << "No user history found.\n";
+            return;
+        }
+
+        out << "\n=== User History ===\n";
+        for (const string& entry : history) {
+            out << entry << endl;
+        }
+    }
+
+    void addBook() {
+        string title, author, id, isbn;
+        out << "Enter title: "; getline(cin, title);
+        out << "Enter author: "; getline(cin, author);
+        out << "Enter ID: "; getline(cin, id);
+        if (idExists(id)) {
+            out << "ID already exists!\n";
+            return;
+        }
+        out << "Enter ISBN: "; getline(cin, isbn);
+
+        if (addBook(title, author, id, isbn)) out << "Book added.\n";
+        else out << "ID already exists!\n";
+    }
+
+    bool addBook(const string& title, const string& author, const string& id, const string& isbn) {
+        record(TraceOp::AddBook, { title, author, id, isbn });
+        if (idExists(id)) return false;
+        return addItem(make_shared<Book>(title, author, id, isbn));
+    }
+
+    void addMagazine() {
+        string title, author, id;
+        out << "Enter title: "; getline(cin, title);
+        out << "Enter author: "; getline(cin, author);
+        out << "Enter ID: "; getline(cin, id);
+        if (idExists(id)) {
+            out << "ID already exists!\n";
+            return;
+        }
+        int issue = getIntInput("Enter issue number: ");
+
+        if (addMagazine(title, author, id, issue)) out << "Magazine added.\n";
+        else out << "ID already exists!\n";
+    }
+
+    bool addMagazine(const string& title, const string& author, const string& id, int issue) {
+        record(TraceOp::AddMagazine, { title, author, id }, { static_cast<uint64_t>(issue) });
+        if (idExists(id)) return false;
+        return addItem(make_shared<Magazine>(title, author, id, issue));
+    }
+
+    void listItems() {
+        record(TraceOp::List);
+        size_t count = catalogSize();
+        if (count == 0) {
+            out << "No items available.\n";
+            return;
+        }
+        holds.expire(time(nullptr));
+        out << "\n=== Available Items ===\n";
+        for (size_t i = 0; i < count; ++i) {
+            if (!isListed(i)) continue;
+            out << i + 1 << ". ";
+            displayItem(i);
+        }
+    }
+
+    void displayItem(size_t handle) {
+        if (shared) {
+            shared->display(handle, out);
+            return;
+        }
+        if (auto book = dynamic_pointer_cast<Book>(items[handle])) {
+            book->setReserved(!holds.reservedFor(book->getId()).empty());
+        }
+        items[handle]->display(out);
+    }
+
+    // Одна сторінка впорядкованого подання; кожна сторінка записується в трасу окремо
+    void browsePage(ViewOrder order, size_t position) {
+        record(TraceOp::Browse, {}, { static_cast<uint64_t>(order), position });
+        syncViews();
+        const OrderedView& view = views.view(order);
+        if (position >= view.size()) throw out_of_range("Invalid position");
+        out << "\n=== Sorted Items " << position + 1 << "-"
+            << min(position + browsePageSize, view.size()) << " of " << view.size() << " ===\n";
+        for (uint32_t handle : view.page(position, browsePageSize)) {
+            out << handle + 1 << ". ";
+            displayItem(handle);
+        }
+    }
+
+    // Посторінковий перегляд у впорядкованому поданні з будь-якої літери чи позиції
+    void browseSorted() {
+        syncViews();
+        int order = getIntInput("Sort by (1 - title, 2 - author, 3 - ID): ");
+        if (order < 1 || order > 3) {
+            out << "Invalid option.\n";
+            return;
+        }
+        const OrderedView& view = views.view(static_cast<ViewOrder>(order - 1));
+        if (view.size() == 0) {
+            out << "No items available.\n";
+            return;
+        }
+
+        size_t position = 0;
+        while (true) {
+            out << "Start from (text, #position or empty for beginning): ";
+            string start;
+            if (!getline(cin, start)) return;
+            if (start.empty()) break;
+            if (start[0] != '#') {
+                position = view.rank(collationKey(start));
+                if (position >= view.size()) {
+                    out << "No items from here.\n";
+                    return;
+                }
+                break;
+            }
+            string digits = start.substr(1);
+            bool numeric = !digits.empty() && digits.size() <= 9 &&
+                           all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; });
+            if (numeric && stoul(digits) >= 1 && stoul(digits) <= view.size()) {
+                position = stoul(digits) - 1;
+                break;
+            }
+            out << "Invalid position. Enter # and a number from 1 to " << view.size() << ".\n";
+        }
+
+        const size_t pageSize = browsePageSize;
+        while (true) {
+            browsePage(static_cast<ViewOrder>(order - 1), position);
+            out << "n - next page, p - previous page, other - back: ";
+            string command;
+            getline(cin, command);
+            if (command == "n" && position + pageSize < view.size()) position += pageSize;
+            else if (command == "p") position = position > pageSize ? position - pageSize : 0;
+            else if (command != "n") return;
+        }
+    }
+
+    void borrowItem() {
+        listItems();
+        size_t count = catalogSize();
+        if (count == 0) return;
+
+        int idx = getIntInput("Enter item number to borrow (0 to cancel): ");
+        if (idx == 0) return;
+        if (idx < 1 || static_cast<size_t>(idx) > count || !isListed(idx - 1)) {
+            out << "Invalid number.\n";
+            return;
+        }
+
+        shared_ptr<LibraryItem> item = itemAt(idx - 1);
+        holds.expire(time(nullptr));
+        auto book = dynamic_pointer_cast<Book>(item);
+        if (book && currentUser.hasBorrowed(book->getId())) {
+            out << "You already have this book.\n";
+            return;
+        }
+        // Зайняту або відкладену для іншого книгу можна зарезервувати замість повторних спроб;
+        // у спільному режимі резервів немає, і borrowAt просто повідомить, що книга зайнята
+        bool placeHold = false;
+        if (!shared && book && (book->getBorrowedStatus() || reservedForOther(*book))) {
+            int answer = getIntInput("Book is not available. Place a hold? (1 - yes, 0 - no): ");
+            if (answer != 1) return;
+            placeHold = true;
+        }
+        borrowAt(idx - 1, placeHold);
+    }
+
+    void borrowAt(size_t handle, bool placeHold) {
+        record(TraceOp::Borrow, {}, { handle, placeHold ? 1u : 0u });
+        shared_ptr<LibraryItem> item = itemAt(handle);
+        if (currentUser.getReaderId() == 0) throw runtime_error("No reader logged in");
+        refreshCurrentUser();
+        holds.expire(time(nullptr));
+
+        if (auto book = dynamic_pointer_cast<Book>(item)) {
+            // Резерв на власну позику після повернення знову відклав би книгу для того ж читача
+            if (currentUser.hasBorrowed(book->getId())) throw runtime_error("You already have this book!");
+            bool borrowed = book->getBorrowedStatus();
+            if (borrowed || reservedForOther(*book)) {
+                if (!placeHold) {
+                    throw runtime_error(borrowed ? "Book already borrowed!" : "Book is reserved for another reader!");
+                }
+                // Черги резервів живуть у пам'яті одного процесу, тож між процесами їх не передати
+                if (shared) throw runtime_error("Holds are not available in --shared mode");
+                if (holds.place(book->getId(), patronKey(), time(nullptr))) {
+                    out << "Hold placed. The book will be reserved for you when it is available.\n";
+                } else {
+                    out << "You already have a hold on this book.\n";
+                }
+                return;
+            }
+            lendItem(handle, item);
+            holds.fulfill(book->getId());
+            return;
+        }
+
+        lendItem(handle, item);
+    }
+
+    void returnItem() {
+        refreshCurrentUser();
+        currentUser.displayBorrowed(out);
+        if (currentUser.borrowedCount() == 0) return;
+
+        int idx = getIntInput("Enter item number to return (0 to cancel): ");
+        if (idx == 0) return;
+        if (idx < 1 || idx > static_cast<int>(currentUser.borrowedCount())) {
+            out << "Invalid number.\n";
+            return;
+        }
+        returnAt(idx - 1);
+    }
+
+    void returnAt(size_t index) {
+        record(TraceOp::Return, {}, { index });
+        refreshCurrentUser();
+        shared_ptr<LibraryItem> item = currentUser.returnItem(index);
+        if (shared) {
+            // Знімається позика саме цього елемента, навіть якщо порядок позик змінився
+            const string& itemId = item->getId();
+            updateSharedReader(currentUser.getReaderId(), [&itemId](ReaderRecord& record) {
+                auto pos = find(record.loans.begin(), record.loans.end(), itemId);
+                if (pos != record.loans.end()) record.loans.erase(pos);
+            });
+            uint64_t record = shared->find(itemId);
+            if (record != SharedCatalog::noRecord && dynamic_pointer_cast<Book>(item)) shared->release(record);
+        } else {
+            readers.removeLoanAt(currentUser.getReaderId(), index);
+        }
+        stats.onReturn(*item);
+        out << "Item returned.\n";
+
+        holds.expire(time(nullptr));
+        string patron = holds.handOff(item->getId(), time(nullptr));
+        if (!patron.empty()) {
+            out << "Item is now reserved for reader " << patron << ".\n";
+        }
+    }
+};
+
+// Відтворення кількох трас паралельно, кожна на своєму екземплярі системи зі свого знімка
+void replayTraces(const vector<string>& paths, bool paced) {
+    vector<vector<TraceEvent>> traces;
+    vector<TraceSnapshot> snapshots(paths.size());
+    for (size_t t = 0; t < paths.size(); ++t) {
+        traces.push_back(TraceWriter::load(paths[t], snapshots[t]));
+    }
+
+    vector<LatencyReport> reports(traces.size());
+    vector<string> errors(traces.size());
+    auto started = chrono::steady_clock::now();
+
+    vector<thread> workers;
+    for (size_t t = 0; t < traces.size(); ++t) {
+        workers.emplace_back([&, t]() {
+            try {
+                LibrarySystem system(snapshots[t]);
+                auto start = chrono::steady_clock::now();
+                for (const TraceEvent& event : traces[t]) {
+                    if (paced) this_thread::sleep_until(start + chrono::microseconds(event.offsetMicros));
+                    auto begin = chrono::steady_clock::now();
+                    try {
+                        system.apply(event);
+                    } catch (const exception&) {
+                        reports[t].addFailure(event.op);
+                        continue;
+                    }
+                    auto end = chrono::steady_clock::now();
+                    reports[t].add(event.op, chrono::duration<double, micro>(end - begin).count());
+                }
+            } catch (const exception& e) {
+                errors[t] = e.what();
+            }
+        });
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    LatencyReport total;
+    size_t operations = 0;
+    for (size_t t = 0; t < traces.size(); ++t) {
+        if (!errors[t].empty()) cerr << "Replay of " << paths[t] << " failed: " << errors[t] << endl;
+        total.merge(reports[t]);
+        operations += traces[t].size();
+    }
+    total.display();
+    cout << "Replayed " << operations << " operations from " << traces.size()
+         << " trace(s) in " << seconds << " s" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        // laba5 [--shared] [--stats] [--trace FILE] | laba5 --replay [--paced] FILE...
+        bool sharedMode = false;
+        bool statsOnly = false;
+        bool paced = false;
+        string tracePath;
+        vector<string> replayPaths;
+        bool replay = false;
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg == "--shared") sharedMode = true;
+            else if (arg == "--stats") statsOnly = true;
+            else if (arg == "--paced") paced = true;
+            else if (arg == "--replay") replay = true;
+            else if (arg == "--trace" && i + 1 < argc) tracePath = argv[++i];
+            else if (replay) replayPaths.push_back(arg);
+        }
+
+        if (!tracePath.empty() && sharedMode) {
+            throw invalid_argument("--trace cannot be used with --shared: other processes change the catalog, "
+                                   "so the trace could not be replayed");
+        }
+        if (replay) {
+            if (replayPaths.empty()) throw invalid_argument("No trace files to replay");
+            replayTraces(replayPaths, paced);
+            return 0;
+        }
+
+        // Пакетний режим: вивести статистику і вийти, нічого не записуючи у файли
+        if (statsOnly) {
+            LibrarySystem system(sharedMode, false);
+            system.showStatistics();
+            return system.verifyStatistics() ? 0 : 2;
+        }
+
+        LibrarySystem system(sharedMode);
+        if (!tracePath.empty()) system.startTrace(tracePath);
         system.run();
     } catch (const exception& e) {
         cerr << "Fatal error: " << e.what() << endl;